@@ -4,6 +4,7 @@
 In $out_dir, creates:
 A bed file with merged reference regions
 BWT index
+k-mer filter of the reference regions, used to skip flanks that can not align
 A file with chromosome sizes
 Table mapping reference regions to which STRs they contain
 
@@ -170,8 +171,8 @@ def GetRefFasta(genome, refkeys, merged_str_file, str_ref_fasta, str_map_file):
     f_fa.close()
     f_map.close()
 
-def bwaIndex(str_ref_fasta):
-    cmd = "lobSTRIndex index -a is %s"%str_ref_fasta
+def bwaIndex(str_ref_fasta, minimizer_k):
+    cmd = "lobSTRIndex index -a is -m %s %s"%(minimizer_k, str_ref_fasta)
     RunCommand(cmd)
 
 ##########################
@@ -181,6 +182,7 @@ if __name__ == "__main__":
     parser.add_argument("--ref", help="Reference genome in fasta format", required=True, type=str)
     parser.add_argument("--out_dir", help="Path to write results to", required=True, type=str)
     parser.add_argument("--extend", help="Length of flanking region to include on either side of the STR. (default 1000)", required=False, type=int, default=1000)
+    parser.add_argument("--minimizer-k", help="k-mer size of the minimizer index used by lobSTR --seeder minimizer, 0 to skip it. (default 0)", required=False, type=int, default=0)
     parser.add_argument("--verbose", help="Print out useful messages", required=False, action="store_true")
     parser.add_argument("--debug", help="Don't run commands, just pring them", required=False, action="store_true")
 
@@ -216,4 +218,4 @@ if __name__ == "__main__":
     if not DEBUG: GetRefFasta(genome, refkeys, merged_str_file, str_ref_fasta, str_map_file)
 
     if VERBOSE: PROGRESS("Building BWA index...")
-    bwaIndex(str_ref_fasta)
+    bwaIndex(str_ref_fasta, args.minimizer_k)
@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "src/AutocorrelationDetection.h"
+#include "src/common.h"
+
+using namespace std;
+
+const size_t AUTOCORRELATION_MAX_LAG = 6;
+// Reads up to this long keep their lag masks on the stack
+const size_t AUTOCORRELATION_STACK_LENGTH = 1024;
+// Score of an unmarked position in a stretch, marked ones score 1. A
+// mismatch in a repeat unmarks two positions: with the base k before
+// it and with the base k after it. Random sequence scores below 0 on
+// average, so stretches don't run on into the flanks
+const int AUTOCORRELATION_MISMATCH_PENALTY = 3;
+
+/*
+  Set bit j of masks[(k-1)*words] when nucs[j] == nucs[j+k] and is not
+  an N, for lags k from 1 to 6, in a single pass over nucs
+ */
+static void LagMatchMasks(const char* nucs, size_t length, size_t words,
+                          uint64_t* masks) {
+  for (size_t w = 0; w < AUTOCORRELATION_MAX_LAG*words; w++) {
+    masks[w] = 0;
+  }
+  size_t j = 0;
+#ifdef __SSE2__
+  const __m128i n = _mm_set1_epi8('N');
+  for (; j + 16 + AUTOCORRELATION_MAX_LAG <= length; j += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nucs + j));
+    int not_n = ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, n)) & 0xffff;
+    for (size_t k = 1; k <= AUTOCORRELATION_MAX_LAG; k++) {
+      __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(nucs + j + k));
+      uint64_t bits = static_cast<uint64_t>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & not_n);
+      // j is a multiple of 16, so the 16 bits never straddle two words
+      masks[(k-1)*words + j/64] |= bits << (j % 64);
+    }
+  }
+#endif
+  for (; j < length; j++) {
+    if (nucs[j] == 'N') continue;
+    for (size_t k = 1; k <= AUTOCORRELATION_MAX_LAG && j + k < length; k++) {
+      if (nucs[j] == nucs[j+k]) {
+        masks[(k-1)*words + j/64] |= static_cast<uint64_t>(1) << (j % 64);
+      }
+    }
+  }
+}
+
+/* First position from pos on whose bit equals value, or end */
+static size_t NextBit(const uint64_t* mask, size_t pos, size_t end, bool value) {
+  while (pos < end) {
+    uint64_t word = value ? mask[pos/64] : ~mask[pos/64];
+    word >>= pos % 64;
+    if (word != 0) {
+      pos += __builtin_ctzll(word);
+      return pos < end ? pos : end;
+    }
+    pos = (pos/64 + 1)*64;
+  }
+  return end;
+}
+
+bool DetectRepeatByAutocorrelation(const string& nucs,
+                                   DetectedRepeat* repeat) {
+  const size_t length = nucs.size();
+  const size_t words = length/64 + 1;
+  uint64_t stack_masks[AUTOCORRELATION_MAX_LAG *
+                       (AUTOCORRELATION_STACK_LENGTH/64 + 1)];
+  vector<uint64_t> heap_masks;
+  uint64_t* masks = stack_masks;
+  if (length > AUTOCORRELATION_STACK_LENGTH) {
+    heap_masks.resize(AUTOCORRELATION_MAX_LAG*words);
+    masks = &heap_masks[0];
+  }
+  LagMatchMasks(nucs.data(), length, words, masks);
+
+  int best_score = 0;
+  bool found = false;
+  for (size_t k = 1; k <= AUTOCORRELATION_MAX_LAG && k < length; k++) {
+    const uint64_t* mask = masks + (k-1)*words;
+    const size_t end = length - k;
+    // A perfect repeat of MIN_REP_LENGTH has this many marked positions
+    // in a row, as required by CheckRepeatCount and the pre-screen
+    const size_t perfect_run = MIN_REP_LENGTH[k-1] - k;
+    // Highest scoring stretch of positions, going over the runs of
+    // marked positions (maximum subarray). The stretch starts at start,
+    // its last run ends before stop
+    int score = 0;
+    size_t start = 0;
+    size_t stop = 0;
+    size_t longest_run = 0;
+    size_t run_stop = 0;
+    for (size_t run_start = NextBit(mask, 0, end, true); run_start < end;
+         run_start = NextBit(mask, run_stop, end, true)) {
+      run_stop = NextBit(mask, run_start, end, false);
+      size_t run_length = run_stop - run_start;
+      int gap_score = AUTOCORRELATION_MISMATCH_PENALTY *
+        static_cast<int>(run_start - stop);
+      if (score > gap_score) {
+        score += static_cast<int>(run_length) - gap_score;
+      } else {
+        score = run_length;
+        start = run_start;
+        longest_run = 0;
+      }
+      stop = run_stop;
+      longest_run = max(longest_run, run_length);
+      if (score > best_score && longest_run >= perfect_run) {
+        best_score = score;
+        found = true;
+        repeat->period = k;
+        repeat->start = start;
+        repeat->end = stop + k - 1;
+      }
+    }
+  }
+  if (found) {
+    repeat->motif = nucs.substr(repeat->start, repeat->period);
+  }
+  return found;
+}
@@ -0,0 +1,54 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_AUTOCORRELATIONDETECTION_H__
+#define SRC_AUTOCORRELATIONDETECTION_H__
+
+#include <stddef.h>
+
+#include <string>
+
+// The repeat found in a read by DetectRepeatByAutocorrelation
+struct DetectedRepeat {
+  // period of the repeat, 1 to 6
+  size_t period;
+  // first and last base of the repeat in the read
+  size_t start;
+  size_t end;
+  // the first period bases of the repeat
+  std::string motif;
+};
+
+/*
+  --detector autocorrelation: find the best period and the extent of
+  the repeat in a single pass over the read. For each lag k from 1 to 6,
+  positions j with nucs[j] == nucs[j+k] are marked, 16 at a time with
+  SSE2. A stretch of period k scores +1 for each marked position and
+  -AUTOCORRELATION_MISMATCH_PENALTY for each unmarked one, and the
+  highest scoring stretch is found as a maximum subarray over the runs
+  of marked positions. Only stretches with a run as long as a perfect
+  repeat of MIN_REP_LENGTH count. The period whose stretch scores
+  highest wins, the smallest period on ties. Returns false if no
+  stretch holds such a run.
+ */
+bool DetectRepeatByAutocorrelation(const std::string& nucs,
+                                   DetectedRepeat* repeat);
+
+#endif  // SRC_AUTOCORRELATIONDETECTION_H__
@@ -19,9 +19,13 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <algorithm>
 #include <map>
@@ -32,6 +36,8 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/AlignmentUtils.h"
 #include "src/BWAReadAligner.h"
+#include "src/FlankFilter.h"
+#include "src/MinimizerIndex.h"
 #include "src/nw.h"
 #include "src/runtime_parameters.h"
 
@@ -42,6 +48,12 @@ const int REFEXTEND = 50;
 extern unsigned char nst_nt4_table[256];
 // Number of N's used to pad each reference
 const int PAD = 50;
+// Shortest exact piece VerifyFlank looks up to find candidate hits
+const int MIN_VERIFY_PIECE = 8;
+// Most mismatches of a flank VerifyFlank accepts. BWA reports hits
+// up to one difference worse than its best, so these are always in
+// what a search of the whole index would report
+const int MAX_VERIFIED_DIFF = 1;
 // max size of cigar score to allow
 // Maximum difference between mate alignment
 // and STR read alignment
@@ -54,6 +66,54 @@ const size_t MAX_MATE_LENGTH = 100;
 const int MAX_MAP_PER_FLANK = 1000;
 // maximum mismatches for the final alignment
 const int MAX_ALIGNMENT_MISMATCHES = 3;
+// --seeder-check: flank alignments closer than this count as the same
+const int SEEDER_CHECK_MAX_SHIFT = 2;
+
+static pthread_mutex_t seeder_check_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t num_seeder_checked_flanks = 0;
+static size_t num_bwt_aligned = 0;
+static size_t num_minimizer_aligned = 0;
+static size_t num_both_aligned = 0;
+static size_t num_same_alignments = 0;
+
+void RecordSeederCheck(const vector<ALIGNMENT>& bwt_alignments,
+                       const vector<ALIGNMENT>& minimizer_alignments) {
+  // Same alignments: every BWT alignment has a minimizer one on the
+  // same locus and strand, at about the same position, and vice versa
+  bool same = (bwt_alignments.size() == minimizer_alignments.size());
+  for (size_t i = 0; same && i < bwt_alignments.size(); i++) {
+    same = false;
+    for (size_t j = 0; j < minimizer_alignments.size(); j++) {
+      if (bwt_alignments[i].id == minimizer_alignments[j].id &&
+          bwt_alignments[i].strand == minimizer_alignments[j].strand &&
+          abs(bwt_alignments[i].pos - minimizer_alignments[j].pos) <=
+          SEEDER_CHECK_MAX_SHIFT) {
+        same = true;
+        break;
+      }
+    }
+  }
+  pthread_mutex_lock(&seeder_check_mutex);
+  num_seeder_checked_flanks++;
+  if (!bwt_alignments.empty()) num_bwt_aligned++;
+  if (!minimizer_alignments.empty()) num_minimizer_aligned++;
+  if (!bwt_alignments.empty() && !minimizer_alignments.empty()) {
+    num_both_aligned++;
+    if (same) num_same_alignments++;
+  }
+  pthread_mutex_unlock(&seeder_check_mutex);
+}
+
+void PrintSeederCheckSummary() {
+  stringstream msg;
+  msg << "Seeder check: " << num_seeder_checked_flanks << " flanks checked, "
+      << "aligned by the BWT seeder " << num_bwt_aligned
+      << ", by the minimizer seeder " << num_minimizer_aligned
+      << ", by both " << num_both_aligned << ", " << num_same_alignments
+      << " of them to the same places within " << SEEDER_CHECK_MAX_SHIFT
+      << "bp";
+  PrintMessageDieOnError(msg.str(), PROGRESS);
+}
 
 // ** copied from BWA ** //
 int64_t pos_end_multi(const bwt_multi1_t *p, int len) {
@@ -70,6 +130,143 @@ int64_t pos_end_multi(const bwt_multi1_t *p, int len) {
   }
 }
 
+// Mismatches between a and b, counting stops past max_diff. 16
+// bases are compared at a time with SSE2
+static int CountMismatches(const char* a, const char* b, int length,
+                           int max_diff) {
+  int mismatches = 0;
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    mismatches += __builtin_popcount(~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))
+                                     & 0xffff);
+    if (mismatches > max_diff) return mismatches;
+  }
+#endif
+  for (; i < length; ++i) {
+    if (a[i] != b[i] && ++mismatches > max_diff) break;
+  }
+  return mismatches;
+}
+
+// An ungapped hit of a flank in a reference sequence
+struct LocusHit {
+  int offset;
+  // true for the flank as it is, false for its reverse complement
+  bool strand;
+  int diff;
+};
+
+/*
+  The order BWA lists the hits of a flank in a locus in: fewest
+  mismatches first, the flank as it is before its reverse complement,
+  then in suffix array order. That is the order of the reference from
+  the hit on for the flank as it is, and of the reference read
+  backwards from the end of the hit for its reverse complement.
+  Which of several hits in a locus GetSharedAlns keeps depends on it
+ */
+class LocusHitOrder {
+ public:
+  LocusHitOrder(const string& refseq, int length)
+    : _refseq(refseq), _length(length) {}
+  bool operator()(const LocusHit& a, const LocusHit& b) const {
+    if (a.diff != b.diff) return a.diff < b.diff;
+    if (a.strand != b.strand) return a.strand;
+    const int size = static_cast<int>(_refseq.size());
+    const int step = a.strand ? 1 : -1;
+    int i = a.strand ? a.offset : a.offset + _length - 1;
+    int j = b.strand ? b.offset : b.offset + _length - 1;
+    while (i >= 0 && i < size && j >= 0 && j < size &&
+           _refseq[i] == _refseq[j]) {
+      i += step;
+      j += step;
+    }
+    // Past the end of the locus counts as smaller than any base
+    if (j < 0 || j >= size) return false;
+    if (i < 0 || i >= size) return true;
+    return _refseq[i] < _refseq[j];
+  }
+ private:
+  const string& _refseq;
+  int _length;
+};
+
+/*
+  Edit distance of query against ref, for alignments starting within
+  band bases of offset and drifting at most band bases off that
+  diagonal. Gaps go only where BWA allows them: at a base of the
+  flank at least end_skip from its start and end_skip-1 from its end.
+  reversed is set when the query is the flank reverse complemented.
+  Only the 2*band+1 cells of each row around the diagonal are filled
+  in, and the search stops once a whole row is over max_edits. *start
+  and *end are where the best alignment starts and ends in ref, the
+  one closest to the diagonal on ties
+ */
+static int BandedEditDistance(const char* query, int length,
+                              const string& ref, int offset, int band,
+                              int end_skip, bool reversed, int max_edits,
+                              int* start, int* end) {
+  const int width = 2*band + 1;
+  const int ref_length = static_cast<int>(ref.size());
+  const int over = max_edits + 1;
+  // cell c of row i ends at ref[offset - band + i + c]
+  vector<int> cost(width), next(width);
+  vector<int> origin(width), next_origin(width);
+  for (int c = 0; c < width; ++c) {
+    const int ref_start = offset - band + c;
+    cost[c] = (ref_start >= 0 && ref_start <= ref_length) ? 0 : over;
+    origin[c] = ref_start;
+  }
+  for (int i = 1; i <= length; ++i) {
+    // base of the flank BWA would be at for a query base missing from
+    // ref, and for a ref base missing after query base i-1
+    const int inserted = reversed ? length - i : i - 1;
+    const int deleted = reversed ? length - 1 - i : i - 1;
+    const bool insertion = (inserted >= end_skip &&
+                            length - inserted >= end_skip);
+    const bool deletion = (deleted >= end_skip && length - deleted >= end_skip);
+    int row_min = over;
+    for (int c = 0; c < width; ++c) {
+      const int ref_end = offset - band + i + c;
+      if (ref_end < 1 || ref_end > ref_length) {
+        next[c] = over;
+        continue;
+      }
+      // match or mismatch, then a query base missing from ref
+      int best = cost[c] + (query[i-1] != ref[ref_end-1]);
+      int best_origin = origin[c];
+      if (insertion && c + 1 < width && cost[c+1] + 1 < best) {
+        best = cost[c+1] + 1;
+        best_origin = origin[c+1];
+      }
+      // a ref base missing from the query
+      if (deletion && c > 0 && next[c-1] + 1 < best) {
+        best = next[c-1] + 1;
+        best_origin = next_origin[c-1];
+      }
+      next[c] = (best < over) ? best : over;
+      next_origin[c] = best_origin;
+      if (next[c] < row_min) row_min = next[c];
+    }
+    if (row_min >= over) return over;
+    cost.swap(next);
+    origin.swap(next_origin);
+  }
+  int best = over;
+  for (int d = 0; d <= band; ++d) {
+    for (int c = band - d; c <= band + d; c += (d == 0) ? 1 : 2*d) {
+      if (cost[c] < best) {
+        best = cost[c];
+        *start = origin[c];
+        *end = offset - band + length + c;
+      }
+    }
+  }
+  return best;
+}
+
 BWAReadAligner::BWAReadAligner(BWT* bwt_reference,
                                BNT* bnt_annotation,
                                map<int, REFSEQ>* ref_sequences,
@@ -78,12 +275,19 @@ BWAReadAligner::BWAReadAligner(BWT* bwt_reference,
   _bwt_reference = bwt_reference;
   _bnt_annotation = bnt_annotation;
   _ref_sequences = ref_sequences;
-  _opts = opts;
+  // BWAAlignFlanks adjusts the options for each flank, so every
+  // aligner needs its own copy when running multiple threads
+  _opts = gap_init_opt();
+  *_opts = *opts;
   _default_opts = gap_init_opt();
   _default_opts->max_diff = 10;
   _default_opts->max_gapo = 1;
   _default_opts->max_gape = 1;
   _default_opts->fnr = -1;
+  _num_exact_flank_searches = 0;
+  _num_gapped_flank_searches = 0;
+  _num_verified_flanks = 0;
+  _num_seeded_flanks = 0;
 }
 
 bool BWAReadAligner::ProcessReadPair(ReadPair* read_pair, string* err, string* messages) {
@@ -253,22 +457,43 @@ bool BWAReadAligner::ProcessRead(MSReadRecord* read, bool passed_detection,
   *err = "Alignment-errors-here:";
   *messages = "Alignment-notes-here:";
 
-  // Align the flanking regions
-  bwa_seq_t* seqs = BWAAlignFlanks(*read);
-  bwa_seq_t* seq_left = &seqs[0];
-  bwa_seq_t* seq_right = &seqs[1];
+  // Flanks the k-mer filter rules out are not searched
+  bool search_left = FlankMayAlign(read->nucleotides.data(),
+                                   read->left_flank_length);
+  bool search_right = FlankMayAlign(read->nucleotides.data() +
+                                    read->nucleotides.size() -
+                                    read->right_flank_length,
+                                    read->right_flank_length);
+  if (!search_left && !search_right) {
+    *err += "No-flank-aligned;";
+    return false;
+  }
 
-  // fill in alignment coordinates
+  // Align the flanking regions and fill in alignment coordinates
   vector<ALIGNMENT> left_alignments, right_alignments;
   bool one_flank_aligned = false;
-  if (GetAlignmentCoordinates(seq_left, &left_alignments)) {
-    one_flank_aligned = true;
+  if (seeder_engine == SEEDER_MINIMIZER) {
+    one_flank_aligned = SeedFlanks(*read, search_left, search_right,
+                                   &left_alignments, &right_alignments);
+  } else if (anchor_verify && search_left && search_right) {
+    one_flank_aligned = AlignFlanksAnchored(*read, &left_alignments,
+                                            &right_alignments);
+  } else {
+    BWAAlignFlanks(*read, search_left, search_right);
+    if (GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::LEFT_FLANK),
+                                &left_alignments)) {
+      one_flank_aligned = true;
+    }
+    if (GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::RIGHT_FLANK),
+                                &right_alignments)) {
+      one_flank_aligned = true;
+    }
   }
-  if (GetAlignmentCoordinates(seq_right, &right_alignments)) {
-    one_flank_aligned = true;
+
+  if (seeder_check) {
+    CheckSeeder(*read, search_left, search_right, left_alignments,
+                right_alignments);
   }
-  // don't need seqs anymore
-  bwa_free_read_seq(2, seqs);
 
   // If didn't find anything, quit
   if (!one_flank_aligned) {
@@ -279,9 +504,9 @@ bool BWAReadAligner::ProcessRead(MSReadRecord* read, bool passed_detection,
   // get shared alignments
   if (!GetSharedAlns(left_alignments, right_alignments,
                      good_left_alignments, good_right_alignments,
-		     static_cast<int>(read->detected_ms_region_nuc.size()),
-		     static_cast<int>(read->left_flank_nuc.size()),
-		     static_cast<int>(read->right_flank_nuc.size()))) {
+		     read->detected_ms_region_length,
+		     read->left_flank_length,
+		     read->right_flank_length)) {
     *err += "No-shared-alignment-found;";
     if (align_debug) {
       PrintMessageDieOnError("[ProcessRead]: No shared alignment found", DEBUG);
@@ -300,60 +525,48 @@ bool BWAReadAligner::ProcessRead(MSReadRecord* read, bool passed_detection,
           good_right_alignments->size() >= 1);
 }
 
-void BWAReadAligner::SetSeq(bwa_seq_t* seq, const string& flank_nuc, const string& flank_qual, const string& readid) {
+bwa_seq_t* BWAReadAligner::SetSeq(BWAWorkspace::Slot slot, const string& flank_nuc, const string& flank_qual) {
   int is_comp = _opts->mode&BWA_MODE_COMPREAD;
-  seq->bc[0] = 0;
+  bwa_seq_t* seq = _workspace.PrepareSeq(slot, flank_nuc.length());
   seq->tid = -1;
-  seq->qual = 0;
   seq->full_len = seq->clip_len = seq->len = flank_nuc.length();
-  seq->seq = reinterpret_cast<ubyte_t*>(calloc(seq->len, 1));
-  seq->qual = reinterpret_cast<ubyte_t*>(calloc(seq->len, 1));
   for (int i = 0; i != seq->full_len; ++i) {
     seq->seq[i] = nst_nt4_table[static_cast<int>(flank_nuc.at(i))];
     if (fastq) {
       seq->qual[i] = (flank_qual.at(i)+33 < 126) ? flank_qual.at(i)+33 : 126;
     } else { seq->qual[i] = 126; }
   }
-  seq->rseq = reinterpret_cast<ubyte_t*>(calloc(seq->full_len, 1));
   memcpy(seq->rseq, seq->seq, seq->len);
   seq_reverse(seq->len, seq->seq, 0);
   seq_reverse(seq->len, seq->rseq, is_comp);
   seq_reverse(seq->len, seq->qual, 0);
-  seq->name = strdup((const char*)readid.c_str());
+  return seq;
 }
 
-bwa_seq_t* BWAReadAligner::BWAAlignFlanks(const MSReadRecord& read) {
-  // set up bwa
-  bwa_seq_t *seqs, *seq_left, *seq_right;
-  seqs = reinterpret_cast<bwa_seq_t*>(calloc(2, sizeof(bwa_seq_t)));
-  seq_left = &seqs[0];
-  seq_right = &seqs[1];
-
+bwa_seq_t* BWAReadAligner::SetFlankSeq(BWAWorkspace::Slot slot, const char* flank_nuc,
+                                       const char* flank_qual, int length) {
+  int is_comp = _opts->mode&BWA_MODE_COMPREAD;
+  bwa_seq_t* seq = _workspace.PrepareSeq(slot, length);
+  seq->tid = -1;
+  seq->full_len = seq->clip_len = seq->len = length;
+  // Same as SetSeq on the reverse complement of the flank, which is
   // left in for historical reasons since BWA reverses sequence
-  const string& left_flank_nuc = reverseComplement(read.left_flank_nuc);
-  const string& right_flank_nuc = reverseComplement(read.right_flank_nuc);
-  const string& left_qual =  reverse(read.quality_scores.
-                                     substr(0, left_flank_nuc.length()));
-  const string& right_qual = reverse(read.quality_scores.
-                                     substr(read.quality_scores.size()
-                                            - right_flank_nuc.length(),
-                                            right_flank_nuc.length()));
-  if (align_debug) {
-    stringstream msg;
-    msg << "[BWAAlignFlanks]: left flank " << left_flank_nuc << " right flank " << right_flank_nuc;
-    PrintMessageDieOnError(msg.str(), DEBUG);
-  }
-  if (left_qual.size() != left_flank_nuc.size() || right_qual.size() != right_flank_nuc.size()) {
-    PrintMessageDieOnError("[BWAAlignFlanks]: Internal error: Qual size does not match nuc size", WARNING);
-    return seqs;
+  for (int i = 0; i != length; ++i) {
+    const int j = length - 1 - i;
+    seq->seq[i] = nst_nt4_table[static_cast<int>(complement(flank_nuc[j]))];
+    if (fastq) {
+      seq->qual[i] = (flank_qual[j]+33 < 126) ? flank_qual[j]+33 : 126;
+    } else { seq->qual[i] = 126; }
   }
+  memcpy(seq->rseq, seq->seq, seq->len);
+  seq_reverse(seq->len, seq->seq, 0);
+  seq_reverse(seq->len, seq->rseq, is_comp);
+  seq_reverse(seq->len, seq->qual, 0);
+  return seq;
+}
 
-  // Set flanking regions
-  SetSeq(seq_left, left_flank_nuc, left_qual, read.ID);
-  SetSeq(seq_right, right_flank_nuc, right_qual, read.ID);
-
-  // call bwa with appropriate options (separate for each flank)
-  if (seq_left->len >= min_length_to_allow_mismatches) {
+void BWAReadAligner::SetFlankOptions(int length) {
+  if (length >= min_length_to_allow_mismatches) {
     _opts->fnr = fpr;
     _opts->max_diff = max_mismatch;
     _opts->max_gapo = gap_open;
@@ -364,22 +577,486 @@ bwa_seq_t* BWAReadAligner::BWAAlignFlanks(const MSReadRecord& read) {
     _opts->max_gapo = 0;
     _opts->max_gape = 0;
   }
-  bwa_cal_sa_reg_gap(0, _bwt_reference->bwt,
-                     1, seq_left, _opts);
-  if (seq_right->len >= min_length_to_allow_mismatches) {
-    _opts->fnr = fpr;
-    _opts->max_diff = max_mismatch;
-    _opts->max_gapo = gap_open;
-    _opts->max_gape = gap_extend;
+}
+
+bool BWAReadAligner::FlankMayAlign(const char* flank_nuc, int length) {
+  const FlankFilter* filter = _bwt_reference->flank_filter;
+  if (filter == NULL) return true;
+  const int max_diff = FlankMaxEdits(length);
+  // Each difference breaks at most one of max_diff+1 disjoint k-mers
+  // of the flank, so any alignment leaves one of them exact. Shorter
+  // flanks can align without an exact k-mer
+  if (length < (max_diff + 1) * static_cast<int>(filter->k())) {
+    return true;
+  }
+  return filter->HasKmerHit(flank_nuc, length);
+}
+
+void BWAReadAligner::SearchFlanks(bool search_left, bool search_right) {
+  // call bwa with appropriate options (separate for each flank)
+  bwa_seq_t* seqs = _workspace.seq(BWAWorkspace::LEFT_FLANK);
+  const bool search[2] = {search_left, search_right};
+  gap_opt_t flank_opts[2];
+  for (int i = 0; i < 2; ++i) {
+    SetFlankOptions(seqs[i].len);
+    flank_opts[i] = *_opts;
+  }
+  // Searching both flanks in one call overlaps their FM-index lookups
+  const int first = search_left ? 0 : 1;
+  const int num_search = search[0] + search[1];
+  if (num_search > 0) {
+    const int num_exact =
+      bwa_cal_sa_reg_gap_ws(_workspace.gap_workspace(), _bwt_reference->bwt,
+                            num_search, seqs + first, flank_opts + first);
+    _num_exact_flank_searches += num_exact;
+    _num_gapped_flank_searches += num_search - num_exact;
+  }
+  // Leave a flank not searched as bwa_cal_sa_reg_gap leaves one without hits
+  for (int i = 0; i < 2; ++i) {
+    if (search[i]) continue;
+    seqs[i].sa = 0;
+    seqs[i].type = BWA_TYPE_NO_MATCH;
+    seqs[i].c1 = seqs[i].c2 = 0;
+    seqs[i].n_aln = 0;
+  }
+}
+
+bool BWAReadAligner::BWAAlignFlanks(const MSReadRecord& read,
+                                    bool search_left,
+                                    bool search_right) {
+  // The flanks are read straight out of the trimmed read: the left
+  // flank starts the read, the right flank ends it
+  const int left_length = read.left_flank_length;
+  const int right_length = read.right_flank_length;
+  const int qual_length = static_cast<int>(read.quality_scores.size());
+  if (align_debug) {
+    stringstream msg;
+    msg << "[BWAAlignFlanks]: left flank "
+        << reverseComplement(read.LeftFlankNucleotides())
+        << " right flank "
+        << reverseComplement(read.RightFlankNucleotides());
+    PrintMessageDieOnError(msg.str(), DEBUG);
+  }
+  if (qual_length < left_length || qual_length < right_length) {
+    PrintMessageDieOnError("[BWAAlignFlanks]: Internal error: Qual size does not match nuc size", WARNING);
+    _workspace.PrepareSeq(BWAWorkspace::LEFT_FLANK, 0);
+    _workspace.PrepareSeq(BWAWorkspace::RIGHT_FLANK, 0);
+    return false;
+  }
+
+  // Set flanking regions
+  SetFlankSeq(BWAWorkspace::LEFT_FLANK, read.nucleotides.data(),
+              read.quality_scores.data(), left_length);
+  SetFlankSeq(BWAWorkspace::RIGHT_FLANK,
+              read.nucleotides.data() + read.nucleotides.size() - right_length,
+              read.quality_scores.data() + qual_length - right_length,
+              right_length);
+
+  SearchFlanks(search_left, search_right);
+  return true;
+}
+
+bool BWAReadAligner::AlignFlanksAnchored(const MSReadRecord& read,
+                                         vector<ALIGNMENT>* left_alignments,
+                                         vector<ALIGNMENT>* right_alignments) {
+  // The longer flank is the more likely to align uniquely
+  const bool anchor_left = read.left_flank_length >= read.right_flank_length;
+  if (!BWAAlignFlanks(read, anchor_left, !anchor_left)) {
+    return false;
+  }
+  vector<ALIGNMENT>* anchor_alignments =
+    anchor_left ? left_alignments : right_alignments;
+  vector<ALIGNMENT>* other_alignments =
+    anchor_left ? right_alignments : left_alignments;
+  GetAlignmentCoordinates(_workspace.seq(anchor_left ?
+                                         BWAWorkspace::LEFT_FLANK :
+                                         BWAWorkspace::RIGHT_FLANK),
+                          anchor_alignments);
+  if (anchor_alignments->size() == 1) {
+    const int other_length = anchor_left ?
+      read.right_flank_length : read.left_flank_length;
+    const char* other_nuc = anchor_left ?
+      read.nucleotides.data() + read.nucleotides.size() - other_length :
+      read.nucleotides.data();
+    ALIGNMENT other_alignment;
+    if (VerifyFlank(other_nuc, other_length, anchor_alignments->front(),
+                    &other_alignment)) {
+      other_alignments->push_back(other_alignment);
+      _num_verified_flanks++;
+      return true;
+    }
+  }
+  // No unique anchor, or the other flank is not in its locus as
+  // expected: search the other flank in the whole index
+  SearchFlanks(!anchor_left, anchor_left);
+  GetAlignmentCoordinates(_workspace.seq(anchor_left ?
+                                         BWAWorkspace::RIGHT_FLANK :
+                                         BWAWorkspace::LEFT_FLANK),
+                          other_alignments);
+  return !left_alignments->empty() || !right_alignments->empty();
+}
+
+int BWAReadAligner::FlankMaxDiff(int length) const {
+  // Same limit SetFlankOptions gives bwa_cal_sa_reg_gap
+  if (length < min_length_to_allow_mismatches) return 0;
+  const int max_diff = (fpr > 0.0) ?
+    bwa_cal_maxdiff(length, BWA_AVG_ERR, fpr) : max_mismatch;
+  return (max_diff < 0) ? 0 : max_diff;
+}
+
+bool BWAReadAligner::VerifyFlank(const char* flank_nuc, int length,
+                                 const ALIGNMENT& anchor,
+                                 ALIGNMENT* alignment) {
+  map<int, REFSEQ>::const_iterator locus = _ref_sequences->find(anchor.id);
+  if (locus == _ref_sequences->end() || length <= 0) return false;
+  const string& refseq = locus->second.sequence;
+  const int max_diff = FlankMaxDiff(length);
+  const string flank_rc = reverseComplement(string(flank_nuc, length));
+  // The whole locus is checked on both strands, since a BWA search
+  // finding the flank twice in the locus gives no shared alignment.
+  // A hit with at most max_diff mismatches has one of max_diff+1
+  // disjoint pieces of the flank exact, so only the offsets where a
+  // piece occurs are compared in full
+  const int num_pieces = max_diff + 1;
+  const int last_offset = static_cast<int>(refseq.size()) - length;
+  int num_hits = 0;
+  int hit_offset = 0;
+  int hit_diff = 0;
+  bool hit_strand = false;
+  for (int strand = 0; strand < 2; ++strand) {
+    const char* nucs = strand ? flank_nuc : flank_rc.data();
+    // offset of the flank at the next occurrence of each piece
+    vector<int> piece_offsets(num_pieces, -1);
+    for (int offset = 0; offset <= last_offset; ++offset) {
+      if (length >= num_pieces * MIN_VERIFY_PIECE) {
+        // jump to the next offset where a piece matches
+        int next = last_offset + 1;
+        for (int piece = 0; piece < num_pieces; ++piece) {
+          const int piece_start = piece * length / num_pieces;
+          if (piece_offsets[piece] < offset) {
+            const int piece_length =
+              (piece + 1) * length / num_pieces - piece_start;
+            const char* found = reinterpret_cast<const char*>(
+              memmem(refseq.data() + offset + piece_start,
+                     refseq.size() - offset - piece_start,
+                     nucs + piece_start, piece_length));
+            piece_offsets[piece] = (found == NULL) ? last_offset + 1 :
+              static_cast<int>(found - refseq.data()) - piece_start;
+          }
+          if (piece_offsets[piece] < next) next = piece_offsets[piece];
+        }
+        offset = next;
+        if (offset > last_offset) break;
+      }
+      const int diff = CountMismatches(refseq.data() + offset, nucs, length,
+                                       max_diff);
+      if (diff > max_diff) continue;
+      if (++num_hits > 1) return false;
+      hit_offset = offset;
+      hit_diff = diff;
+      hit_strand = (strand == 1);
+    }
+  }
+  // A hit with more mismatches may be one the search would drop for a
+  // better hit elsewhere in the index
+  if (num_hits != 1 || hit_strand != anchor.strand ||
+      hit_diff > MAX_VERIFIED_DIFF) {
+    return false;
+  }
+  // Coordinates GetAlignmentCoordinates gives a BWA hit at this offset
+  *alignment = anchor;
+  alignment->pos = (anchor.start-extend-PAD) + hit_offset +
+    (anchor.strand ? 1 : 0);
+  alignment->endpos = alignment->pos + length;
+  if (align_debug) {
+    stringstream msg;
+    msg << "[VerifyFlank]: flank found in locus " << anchor.id
+        << " at " << alignment->pos;
+    PrintMessageDieOnError(msg.str(), DEBUG);
+  }
+  return true;
+}
+
+int BWAReadAligner::FlankMaxEdits(int length) const {
+  int max_edits = FlankMaxDiff(length);
+  // Gap extensions only count as differences in BWA_MODE_GAPE
+  if (length >= min_length_to_allow_mismatches &&
+      !(_opts->mode & BWA_MODE_GAPE)) {
+    max_edits += gap_open * gap_extend;
+  }
+  return max_edits;
+}
+
+bool BWAReadAligner::SeedFlanks(const MSReadRecord& read, bool search_left,
+                                bool search_right,
+                                vector<ALIGNMENT>* left_alignments,
+                                vector<ALIGNMENT>* right_alignments) {
+  left_alignments->clear();
+  right_alignments->clear();
+  const int left_length = read.left_flank_length;
+  const int right_length = read.right_flank_length;
+  const char* right_nuc = read.nucleotides.data() +
+    read.nucleotides.size() - right_length;
+  // Flanks with too few minimizers to find every hit are searched
+  // with BWA instead
+  const bool bwt_left = search_left &&
+    !TrySeedFlank(read.nucleotides.data(), left_length, left_alignments);
+  const bool bwt_right = search_right &&
+    !TrySeedFlank(right_nuc, right_length, right_alignments);
+  if ((bwt_left || bwt_right) &&
+      BWAAlignFlanks(read, bwt_left, bwt_right)) {
+    if (bwt_left) {
+      GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::LEFT_FLANK),
+                              left_alignments);
+    }
+    if (bwt_right) {
+      GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::RIGHT_FLANK),
+                              right_alignments);
+    }
+  }
+  return !left_alignments->empty() || !right_alignments->empty();
+}
+
+bool BWAReadAligner::TrySeedFlank(const char* flank_nuc, int length,
+                                  vector<ALIGNMENT>* alignments) {
+  const int num_windows = SketchFlank(flank_nuc, length);
+  if (num_windows <= FlankMaxDiff(length)) return false;
+  // Without an ungapped hit, gapped ones are only sure to be found if
+  // the gaps leave a window intact too
+  const bool gapped = (num_windows > FlankMaxEdits(length));
+  if (!SeedFlank(flank_nuc, length, gapped, alignments) && !gapped) {
+    return false;
+  }
+  _num_seeded_flanks++;
+  return true;
+}
+
+int BWAReadAligner::SketchFlank(const char* flank_nuc, int length) {
+  const MinimizerIndex* index = _bwt_reference->minimizer_index;
+  const int k = index->k();
+  const int w = index->w();
+  // A flank shorter than a window of k-mers need not share a
+  // minimizer with the reference where it aligns
+  _minimizers.clear();
+  if (length < k + w - 1) return 0;
+  index->Sketch(flank_nuc, length, &_minimizers);
+  // A minimizer too common to be looked up finds nothing
+  _minimizer_kept.resize(_minimizers.size());
+  for (size_t i = 0; i < _minimizers.size(); i++) {
+    const uint64_t* positions;
+    _minimizer_kept[i] = (index->Lookup(_minimizers[i].hash, &positions) <=
+                          static_cast<size_t>(MAX_MAP_PER_FLANK));
+  }
+  // Where a window of w k-mers aligns without a difference, the
+  // reference has its minimizers too. Its minimizers are the ones in
+  // it with the smallest hash, and the window counts if one of them is
+  // looked up. Count the windows that do not overlap
+  const int last_window = length - k - w + 1;
+  int num_windows = 0;
+  int next_window = 0;
+  size_t first = 0;
+  for (int window = 0; window <= last_window; window++) {
+    while (first < _minimizers.size() &&
+           static_cast<int>(_minimizers[first].pos >> 1) < window) {
+      first++;
+    }
+    if (window < next_window) continue;
+    uint32_t min_hash = ~0U;
+    bool kept = false;
+    for (size_t i = first; i < _minimizers.size() &&
+           static_cast<int>(_minimizers[i].pos >> 1) < window + w; i++) {
+      if (_minimizers[i].hash < min_hash) {
+        min_hash = _minimizers[i].hash;
+        kept = _minimizer_kept[i];
+      } else if (_minimizers[i].hash == min_hash) {
+        kept = kept || _minimizer_kept[i];
+      }
+    }
+    if (kept) {
+      num_windows++;
+      next_window = window + k + w - 1;
+    }
+  }
+  size_t num_kept = 0;
+  for (size_t i = 0; i < _minimizers.size(); i++) {
+    if (_minimizer_kept[i]) _minimizers[num_kept++] = _minimizers[i];
+  }
+  _minimizers.resize(num_kept);
+  return num_windows;
+}
+
+bool BWAReadAligner::SeedFlank(const char* flank_nuc, int length,
+                               bool gapped, vector<ALIGNMENT>* alignments) {
+  alignments->clear();
+  const MinimizerIndex* index = _bwt_reference->minimizer_index;
+  const int k = index->k();
+  const int max_diff = FlankMaxDiff(length);
+  const int max_edits = FlankMaxEdits(length);
+  // Gaps BWA could open and extend move the flank at most this far
+  // off the diagonal of a minimizer hit
+  int band = (gapped && length >= min_length_to_allow_mismatches &&
+              gap_open > 0) ? gap_open + gap_extend : 0;
+  if (band > max_edits) band = max_edits;
+
+  // Each reference hit of a minimizer puts the flank at an offset in
+  // a reference sequence, seqid << 32 | offset << 1 | strand. Strand
+  // 1 is the flank as it is, strand 0 its reverse complement
+  _seed_candidates.clear();
+  for (size_t i = 0; i < _minimizers.size(); i++) {
+    const uint64_t* positions;
+    const size_t num_positions = index->Lookup(_minimizers[i].hash,
+                                               &positions);
+    const int query_pos = static_cast<int>(_minimizers[i].pos >> 1);
+    const uint32_t query_strand = _minimizers[i].pos & 1;
+    for (size_t j = 0; j < num_positions; j++) {
+      const uint64_t seqid = positions[j] >> 32;
+      const int ref_pos = static_cast<int>((positions[j] & 0xffffffff) >> 1);
+      const uint32_t strand = ((positions[j] & 1) == query_strand) ? 1 : 0;
+      const int offset = strand ? ref_pos - query_pos :
+        ref_pos - (length - query_pos - k);
+      if (offset < 0) continue;
+      _seed_candidates.push_back(seqid << 32 |
+                                 static_cast<uint64_t>(offset) << 1 | strand);
+    }
+  }
+  if (_seed_candidates.empty()) return false;
+  sort(_seed_candidates.begin(), _seed_candidates.end());
+  _seed_candidates.erase(unique(_seed_candidates.begin(),
+                                _seed_candidates.end()),
+                         _seed_candidates.end());
+
+  // Candidates are checked without gaps. SketchFlank made sure every
+  // hit BWA could report is among them. Like BWA, only hits at most
+  // one difference worse than the best are kept, listed in its order
+  const string flank_rc = reverseComplement(string(flank_nuc, length));
+  vector<uint64_t> hits;
+  vector<LocusHit> locus_hits;
+  vector<uint64_t> locus_seqids;
+  int best_diff = max_diff;
+  for (size_t i = 0, next = 0; i < _seed_candidates.size(); i = next) {
+    const uint64_t seqid = _seed_candidates[i] >> 32;
+    while (next < _seed_candidates.size() &&
+           (_seed_candidates[next] >> 32) == seqid) {
+      next++;
+    }
+    ALIGNMENT refid;
+    ParseRefid(_bnt_annotation->bns->anns[seqid].name, &refid);
+    map<int, REFSEQ>::const_iterator locus = _ref_sequences->find(refid.id);
+    if (locus == _ref_sequences->end()) continue;
+    const string& refseq = locus->second.sequence;
+    const size_t first = locus_hits.size();
+    for (size_t j = i; j < next; j++) {
+      LocusHit hit;
+      hit.offset = static_cast<int>((_seed_candidates[j] & 0xffffffff) >> 1);
+      hit.strand = (_seed_candidates[j] & 1);
+      if (hit.offset + length > static_cast<int>(refseq.size())) continue;
+      hit.diff = CountMismatches(refseq.data() + hit.offset,
+                                 hit.strand ? flank_nuc : flank_rc.data(),
+                                 length, max_diff);
+      if (hit.diff > max_diff) continue;
+      if (hit.diff < best_diff) best_diff = hit.diff;
+      locus_hits.push_back(hit);
+      locus_seqids.push_back(seqid);
+    }
+    sort(locus_hits.begin() + first, locus_hits.end(),
+         LocusHitOrder(refseq, length));
+  }
+  for (size_t i = 0; i < locus_hits.size(); i++) {
+    if (locus_hits[i].diff > best_diff + 1) continue;
+    hits.push_back(locus_seqids[i] << 32 |
+                   static_cast<uint64_t>(locus_hits[i].offset) << 1 |
+                   (locus_hits[i].strand ? 1 : 0));
+  }
+
+  // BWA reports no gapped alignment of a flank with an ungapped one,
+  // so only without any the candidates get a banded alignment, unless
+  // a hit was already found close by
+  if (hits.empty() && band > 0) {
+    uint64_t seqid = ~0ULL;
+    map<int, REFSEQ>::const_iterator locus = _ref_sequences->end();
+    for (size_t i = 0; i < _seed_candidates.size(); i++) {
+      if (_seed_candidates[i] >> 32 != seqid) {
+        seqid = _seed_candidates[i] >> 32;
+        ALIGNMENT refid;
+        ParseRefid(_bnt_annotation->bns->anns[seqid].name, &refid);
+        locus = _ref_sequences->find(refid.id);
+      }
+      if (locus == _ref_sequences->end()) continue;
+      const int offset =
+        static_cast<int>((_seed_candidates[i] & 0xffffffff) >> 1);
+      const bool strand = (_seed_candidates[i] & 1);
+      bool near_hit = false;
+      for (size_t j = 0; j < hits.size() && !near_hit; j++) {
+        const int hit_offset = static_cast<int>((hits[j] & 0xffffffff) >> 1);
+        near_hit = ((hits[j] >> 32) == seqid && (hits[j] & 1) == strand &&
+                    abs(hit_offset - offset) <= band);
+      }
+      if (near_hit) continue;
+      int start = offset;
+      int end = offset + length;
+      if (BandedEditDistance(strand ? flank_nuc : flank_rc.data(), length,
+                             locus->second.sequence, offset, band,
+                             _opts->indel_end_skip, !strand, max_edits,
+                             &start, &end)
+          <= max_edits) {
+        // GetAlignmentCoordinates puts a gapped hit of the reverse
+        // complement as many bases off its start as the gaps change
+        // its length by
+        if (!strand) start += (end - start) - length;
+        hits.push_back(seqid << 32 | static_cast<uint64_t>(start) << 1 |
+                       (strand ? 1 : 0));
+      }
+    }
+  }
+  // Like bwa_aln2seq_core, a flank with too many hits has none
+  if (hits.size() > static_cast<size_t>(MAX_MAP_PER_FLANK)) return false;
+
+  // Same coordinates GetAlignmentCoordinates gives a BWA hit
+  for (size_t i = 0; i < hits.size(); i++) {
+    ALIGNMENT refid;
+    ParseRefid(_bnt_annotation->bns->anns[hits[i] >> 32].name, &refid);
+    refid.strand = (hits[i] & 1);
+    refid.pos = (refid.start-extend-PAD) +
+      static_cast<int>((hits[i] & 0xffffffff) >> 1) + (refid.strand ? 1 : 0);
+    refid.endpos = refid.pos + length;
+    alignments->push_back(refid);
+  }
+  if (align_debug) {
+    stringstream msg;
+    msg << "[SeedFlank]: " << _minimizers.size() << " minimizers, "
+        << _seed_candidates.size() << " candidates, "
+        << alignments->size() << " alignments";
+    PrintMessageDieOnError(msg.str(), DEBUG);
+  }
+  return !alignments->empty();
+}
+
+void BWAReadAligner::CheckSeeder(const MSReadRecord& read, bool search_left,
+                                 bool search_right,
+                                 const vector<ALIGNMENT>& left_alignments,
+                                 const vector<ALIGNMENT>& right_alignments) {
+  // The extra searches are left out of the run stats
+  const size_t num_exact = _num_exact_flank_searches;
+  const size_t num_gapped = _num_gapped_flank_searches;
+  const size_t num_seeded = _num_seeded_flanks;
+  vector<ALIGNMENT> other_left, other_right;
+  if (seeder_engine == SEEDER_MINIMIZER) {
+    if (BWAAlignFlanks(read, search_left, search_right)) {
+      GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::LEFT_FLANK),
+                              &other_left);
+      GetAlignmentCoordinates(_workspace.seq(BWAWorkspace::RIGHT_FLANK),
+                              &other_right);
+      if (search_left) RecordSeederCheck(other_left, left_alignments);
+      if (search_right) RecordSeederCheck(other_right, right_alignments);
+    }
   } else {
-    _opts->fnr = -1;
-    _opts->max_diff = 0;
-    _opts->max_gapo = 0;
-    _opts->max_gape = 0;
+    SeedFlanks(read, search_left, search_right, &other_left, &other_right);
+    if (search_left) RecordSeederCheck(left_alignments, other_left);
+    if (search_right) RecordSeederCheck(right_alignments, other_right);
   }
-  bwa_cal_sa_reg_gap(0, _bwt_reference->bwt,
-                     1, seq_right, _opts);
-  return seqs;
+  _num_exact_flank_searches = num_exact;
+  _num_gapped_flank_searches = num_gapped;
+  _num_seeded_flanks = num_seeded;
 }
 
 void BWAReadAligner::ParseRefid(const string& refstring, ALIGNMENT* refid) {
@@ -675,24 +1352,18 @@ bool BWAReadAligner::AlignMate(const ReadPair& read_pair,
                                at(1-num_aligned_read).orig_qual);
 
   // set up BWA alignment
-  bwa_seq_t *seq = reinterpret_cast<bwa_seq_t*>(calloc(1, sizeof(bwa_seq_t)));
-  SetSeq(seq, nucs, qual, read_pair.reads.at(1-num_aligned_read).ID.c_str());
+  bwa_seq_t *seq = SetSeq(BWAWorkspace::MATE, nucs, qual);
 
   // call bwa with appropriate options
-  bwa_cal_sa_reg_gap(0, _bwt_reference->bwt, 1, seq, _default_opts);
+  bwa_cal_sa_reg_gap_ws(_workspace.gap_workspace(), _bwt_reference->bwt,
+                        1, seq, _default_opts);
 
   if (seq->n_aln == 0) {
-    bwa_free_read_seq(1, seq);
     return false;
   }
 
   // Check alignment coordinates
-  if (!GetAlignmentCoordinates(seq, mate_alignments)) {
-    bwa_free_read_seq(1, seq);
-    return false;
-  }
-  bwa_free_read_seq(1, seq);
-  return true;
+  return GetAlignmentCoordinates(seq, mate_alignments);
 }
 
 bool BWAReadAligner::CheckMateAlignment(const vector<ALIGNMENT>&
@@ -745,10 +1416,10 @@ bool BWAReadAligner::OutputAlignment(ReadPair* read_pair,
   read_pair->reads.at(aligned_read_num).repseq = left_alignment.repeat;
   read_pair->reads.at(aligned_read_num).lStart = left_alignment.pos;
   read_pair->reads.at(aligned_read_num).lEnd = left_alignment.pos +
-    read_pair->reads.at(aligned_read_num).left_flank_nuc.length();
+    read_pair->reads.at(aligned_read_num).left_flank_length;
   read_pair->reads.at(aligned_read_num).rStart = right_alignment.pos;
   read_pair->reads.at(aligned_read_num).rEnd = right_alignment.pos +
-    read_pair->reads.at(aligned_read_num).right_flank_nuc.length();
+    read_pair->reads.at(aligned_read_num).right_flank_length;
 
   read_pair->alternate_mappings = alternate_mappings;
   read_pair->other_spanned_strs = left_alignment.other_spanned_strs;
@@ -974,4 +1645,14 @@ bool BWAReadAligner::AdjustAlignment(MSReadRecord* aligned_read) {
   return false;
 }
 
-BWAReadAligner::~BWAReadAligner() {}
+void BWAReadAligner::AddSearchStats(RunInfo* info) const {
+  info->num_exact_flank_searches += _num_exact_flank_searches;
+  info->num_gapped_flank_searches += _num_gapped_flank_searches;
+  info->num_verified_flanks += _num_verified_flanks;
+  info->num_seeded_flanks += _num_seeded_flanks;
+}
+
+BWAReadAligner::~BWAReadAligner() {
+  free(_opts);
+  free(_default_opts);
+}
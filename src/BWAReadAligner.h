@@ -26,8 +26,16 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "src/Alignment.h"
+#include "src/BWAWorkspace.h"
 #include "src/common.h"
 #include "src/ReadPair.h"
+#include "src/RunInfo.h"
+#include "src/mzindex.h"
+
+// --seeder-check: compare the alignments both seeders found for a flank
+void RecordSeederCheck(const std::vector<ALIGNMENT>& bwt_alignments,
+                       const std::vector<ALIGNMENT>& minimizer_alignments);
+void PrintSeederCheckSummary();
 
 class BWAReadAligner {
  public:
@@ -42,6 +50,9 @@ class BWAReadAligner {
   bool ProcessPairedEndRead(ReadPair* read_pair, std::string* err, std::string* messages);
   bool ProcessSingleEndRead(ReadPair* read_pair, std::string* err, std::string* messages);
 
+  // Add the number of flanks searched each way to the run stats
+  void AddSearchStats(RunInfo* info) const;
+
  protected:
   // Process a single read of a pair
   // Return possible alignments of flanking regions
@@ -53,12 +64,84 @@ class BWAReadAligner {
                    std::string* err,
                    std::string* messages);
 
-  // Set up sequence info for BWA
-  void SetSeq(bwa_seq_t* seq, const std::string& flank_nuc,
-	      const std::string& flank_qual, const std::string& readid);
-
-  // Call BWA to align flanking regions
-  bwa_seq_t* BWAAlignFlanks(const MSReadRecord& read);
+  // Set up sequence info for BWA in a workspace slot
+  bwa_seq_t* SetSeq(BWAWorkspace::Slot slot, const std::string& flank_nuc,
+                    const std::string& flank_qual);
+
+  // Set up sequence info for BWA from a flank of length nucleotides
+  // inside the read, without copying it out first
+  bwa_seq_t* SetFlankSeq(BWAWorkspace::Slot slot, const char* flank_nuc,
+                         const char* flank_qual, int length);
+
+  // Set the BWA options for a flank of length nucleotides
+  void SetFlankOptions(int length);
+
+  // False if the k-mer filter of the index shows the flank can not
+  // align within the allowed differences
+  bool FlankMayAlign(const char* flank_nuc, int length);
+
+  // Call BWA to align the flanks set up in the workspace, marking
+  // the ones not searched as not aligned
+  void SearchFlanks(bool search_left, bool search_right);
+
+  // Call BWA to align flanking regions, leaving the results in the
+  // LEFT_FLANK and RIGHT_FLANK slots of the workspace. False if the
+  // flanks could not be set up
+  bool BWAAlignFlanks(const MSReadRecord& read, bool search_left,
+                      bool search_right);
+
+  // Align the longer flank with BWA and, if it aligns uniquely, look
+  // for the other one only in that locus. Falls back to a BWA search
+  // of the other flank. True if either flank aligned
+  bool AlignFlanksAnchored(const MSReadRecord& read,
+                           std::vector<ALIGNMENT>* left_alignments,
+                           std::vector<ALIGNMENT>* right_alignments);
+
+  // Largest number of mismatches BWA allows in a flank of length
+  // nucleotides
+  int FlankMaxDiff(int length) const;
+
+  // Largest number of differences, gap extensions included, BWA
+  // allows in a flank of length nucleotides
+  int FlankMaxEdits(int length) const;
+
+  // Align the flanks with the minimizer index of the reference.
+  // Flanks SketchFlank turns down are searched with BWA. True if
+  // either flank aligned
+  bool SeedFlanks(const MSReadRecord& read, bool search_left,
+                  bool search_right,
+                  std::vector<ALIGNMENT>* left_alignments,
+                  std::vector<ALIGNMENT>* right_alignments);
+
+  // Align the flank with SeedFlank if its minimizers are sure to find
+  // every hit BWA could report. False if it needs a BWA search
+  bool TrySeedFlank(const char* flank_nuc, int length,
+                    std::vector<ALIGNMENT>* alignments);
+
+  // Find the minimizers of the flank worth looking up. Returns how
+  // many differences it takes to hide all of them: a flank that
+  // aligns with fewer has a minimizer where it aligns
+  int SketchFlank(const char* flank_nuc, int length);
+
+  // Every alignment of the flank within the limits BWA would use, in
+  // the loci its minimizers hit, gapped ones only if gapped is set.
+  // SketchFlank must be called on the flank first
+  bool SeedFlank(const char* flank_nuc, int length, bool gapped,
+                 std::vector<ALIGNMENT>* alignments);
+
+  // Align the flanks with the seeder not in use as well, and record
+  // how the alignments compare
+  void CheckSeeder(const MSReadRecord& read, bool search_left,
+                   bool search_right,
+                   const std::vector<ALIGNMENT>& left_alignments,
+                   const std::vector<ALIGNMENT>& right_alignments);
+
+  // True if the flank has exactly one hit with at most FlankMaxDiff
+  // mismatches in the locus of anchor, on the anchor's strand, and
+  // that hit has at most MAX_VERIFIED_DIFF mismatches. The hit is
+  // returned in *alignment
+  bool VerifyFlank(const char* flank_nuc, int length,
+                   const ALIGNMENT& anchor, ALIGNMENT* alignment);
 
   // Get info from ref fields of index
   void ParseRefid(const std::string& refstring, ALIGNMENT* refid);
@@ -121,6 +204,20 @@ class BWAReadAligner {
   gap_opt_t *_opts;
   // default options
   gap_opt_t *_default_opts;
+  // buffers reused by every BWA search of this aligner
+  BWAWorkspace _workspace;
+  // flanks that only needed an exact search, and the rest
+  size_t _num_exact_flank_searches;
+  size_t _num_gapped_flank_searches;
+  // flanks found in the locus of the other flank without a search
+  size_t _num_verified_flanks;
+  // flanks aligned through the minimizer index
+  size_t _num_seeded_flanks;
+  // minimizers and reference candidates of the flank SeedFlank is on
+  std::vector<mz_t> _minimizers;
+  std::vector<uint64_t> _seed_candidates;
+  // which of the flank's minimizers SketchFlank looks up
+  std::vector<bool> _minimizer_kept;
 };
 
 #endif  // SRC_BWAREADALIGNER_H_
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/BWAWorkspace.h"
+
+BWAWorkspace::BWAWorkspace() {
+  memset(_seqs, 0, sizeof(_seqs));
+  memset(_capacity, 0, sizeof(_capacity));
+  _gap_workspace = gap_init_workspace();
+}
+
+BWAWorkspace::~BWAWorkspace() {
+  for (int i = 0; i != NUM_SEQS; ++i) {
+    PrepareSeq(static_cast<Slot>(i), 0);
+    free(_seqs[i].seq);
+    free(_seqs[i].rseq);
+    free(_seqs[i].qual);
+    free(_seqs[i].aln);
+  }
+  gap_destroy_workspace(_gap_workspace);
+}
+
+bwa_seq_t* BWAWorkspace::PrepareSeq(Slot slot, int length) {
+  bwa_seq_t* p = &_seqs[slot];
+  // Results of the last search are freed as bwa_free_read_seq does
+  for (int j = 0; j < p->n_multi; ++j) {
+    free(p->multi[j].cigar);
+  }
+  free(p->multi);
+  free(p->md);
+  free(p->cigar);
+  free(p->name);
+  // The sequence and hit buffers are kept
+  ubyte_t* seq = p->seq;
+  ubyte_t* rseq = p->rseq;
+  ubyte_t* qual = p->qual;
+  bwt_aln1_t* aln = p->aln;
+  int m_aln = p->m_aln;
+  if (length > _capacity[slot]) {
+    _capacity[slot] = length;
+    seq = reinterpret_cast<ubyte_t*>(realloc(seq, length));
+    rseq = reinterpret_cast<ubyte_t*>(realloc(rseq, length));
+    qual = reinterpret_cast<ubyte_t*>(realloc(qual, length));
+  }
+  memset(p, 0, sizeof(bwa_seq_t));
+  p->seq = seq;
+  p->rseq = rseq;
+  p->qual = qual;
+  p->aln = aln;
+  p->m_aln = m_aln;
+  return p;
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_BWAWORKSPACE_H__
+#define SRC_BWAWORKSPACE_H__
+
+#include "src/bwtaln.h"
+#include "src/bwtgap.h"
+
+/*
+  Buffers for the BWA searches of one aligner, kept from read to read
+  so that aligning a flank does not allocate once they have grown to
+  the longest sequence seen. Not thread safe: each aligner owns one.
+ */
+class BWAWorkspace {
+ public:
+  // The flanks are adjacent, so both can be passed to BWA as one array
+  enum Slot {LEFT_FLANK, RIGHT_FLANK, MATE, NUM_SEQS};
+
+  BWAWorkspace();
+  ~BWAWorkspace();
+
+  // Clear the sequence in slot, as a freshly allocated one, with
+  // seq, rseq and qual holding at least length bases
+  bwa_seq_t* PrepareSeq(Slot slot, int length);
+  bwa_seq_t* seq(Slot slot) { return &_seqs[slot]; }
+  gap_workspace_t* gap_workspace() { return _gap_workspace; }
+
+ private:
+  BWAWorkspace(const BWAWorkspace&);
+  BWAWorkspace& operator=(const BWAWorkspace&);
+
+  bwa_seq_t _seqs[NUM_SEQS];
+  // bases seq, rseq and qual of each slot can hold
+  int _capacity[NUM_SEQS];
+  gap_workspace_t* _gap_workspace;
+};
+
+#endif  // SRC_BWAWORKSPACE_H__
@@ -0,0 +1,230 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+
+#include "src/api/BamConstants.h"
+#include "src/BamCollatingFileReader.h"
+#include "src/BamPairedFileReader.h"
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+
+using namespace std;
+namespace Constants = BamTools::Constants;
+
+// Supplementary alignments are not known to this version of BamTools
+static const uint16_t BAM_ALIGNMENT_SUPPLEMENTARY = 0x800;
+
+static size_t HashName(const string& name) {
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < name.size(); i++) {
+    hash ^= static_cast<unsigned char>(name[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+BamCollatingFileReader::BamCollatingFileReader(const std::string& _filename)
+  : reader(create_bam_record_source(_filename)),
+    current_spill(-1),
+    draining(false),
+    num_spilled(0),
+    num_orphans(0) {}
+
+BamCollatingFileReader::~BamCollatingFileReader() {
+  for (size_t i = 0; i < spill_files.size(); i++) {
+    if (spill_files[i] != NULL) fclose(spill_files[i]);
+  }
+  delete reader;
+}
+
+bool BamCollatingFileReader::GetNextRecord(ReadPair* read_pair) {
+  // Fill the reads in place, so their strings keep their memory
+  while (true) {
+    if (!draining) {
+      if (GetNextBamRecord()) {
+        // Only primary alignments are paired, there is one per mate
+        if (record.flag & (Constants::BAM_ALIGNMENT_SECONDARY |
+                           BAM_ALIGNMENT_SUPPLEMENTARY)) {
+          continue;
+        }
+        if (!record.IsPaired()) {
+          read_pair->reads.resize(1);
+          BamPairedFileReader::FillRead(record, false, &read_pair->reads[0]);
+          return true;
+        }
+        string name = BamPairedFileReader::MateName(record.name);
+        PendingMates::iterator mate = pending.find(name);
+        if (mate == pending.end()) {
+          pending[name].swap(record);
+          if (current_spill < 0 &&
+              pending.size() > static_cast<size_t>(collate_max_pending)) {
+            SpillPending();
+          }
+          continue;
+        }
+        // The second read of the pair is the one reverse complemented,
+        // as for name sorted input. Without flags, file order decides
+        const BamRecord* first = &mate->second;
+        const BamRecord* second = &record;
+        if ((record.flag & Constants::BAM_ALIGNMENT_READ_1) ||
+            (mate->second.flag & Constants::BAM_ALIGNMENT_READ_2)) {
+          first = &record;
+          second = &mate->second;
+        }
+        read_pair->reads.resize(2);
+        BamPairedFileReader::FillRead(*first, false, &read_pair->reads[0]);
+        BamPairedFileReader::FillRead(*second, true, &read_pair->reads[1]);
+        pending.erase(mate);
+        return true;
+      }
+      if (current_spill < 0 && !spill_files.empty()) {
+        // Pair the spilled mates one partition at a time
+        SpillPending();
+        current_spill = 0;
+        rewind(spill_files[current_spill]);
+        continue;
+      }
+      draining = true;
+    }
+    if (!pending.empty()) {
+      read_pair->reads.resize(1);
+      BamPairedFileReader::FillRead(pending.begin()->second, false,
+                                    &read_pair->reads[0]);
+      read_pair->reads[0].paired = false;
+      pending.erase(pending.begin());
+      num_orphans++;
+      return true;
+    }
+    if (current_spill >= 0 &&
+        current_spill + 1 < static_cast<int>(spill_files.size())) {
+      fclose(spill_files[current_spill]);
+      spill_files[current_spill] = NULL;
+      current_spill++;
+      rewind(spill_files[current_spill]);
+      draining = false;
+      continue;
+    }
+    if (num_orphans > 0) {
+      stringstream msg;
+      msg << "Could not find pairs for " << num_orphans
+          << " reads of the bam file. They were processed as single reads";
+      PrintMessageDieOnError(msg.str(), WARNING);
+      num_orphans = 0;
+    }
+    return false;
+  }
+}
+
+bool BamCollatingFileReader::GetNextRead(MSReadRecord* read) {
+  // check if any lines left
+  if (!reader->GetNextRecord(&record)) {
+    return false;
+  }
+  BamPairedFileReader::FillRead(record, false, read);
+  return true;
+}
+
+bool BamCollatingFileReader::GetNextBamRecord() {
+  if (current_spill < 0) {
+    return reader->GetNextRecord(&record);
+  }
+  return ReadSpillRecord(spill_files[current_spill], &record);
+}
+
+FILE* BamCollatingFileReader::CreateSpillFile() {
+  const char* tmp_dir = getenv("TMPDIR");
+  string path = string(tmp_dir != NULL ? tmp_dir : "/tmp") +
+    "/lobSTR_collate_XXXXXX";
+  vector<char> path_template(path.begin(), path.end());
+  path_template.push_back('\0');
+  int fd = mkstemp(&path_template[0]);
+  if (fd == -1) {
+    PrintMessageDieOnError("Could not create temporary file " + path, ERROR);
+  }
+  // Removed now, so it goes away with the file descriptor
+  unlink(&path_template[0]);
+  FILE* file = fdopen(fd, "w+b");
+  if (file == NULL) {
+    err(1, "fdopen() failed");
+  }
+  return file;
+}
+
+void BamCollatingFileReader::SpillPending() {
+  if (spill_files.empty()) {
+    for (int i = 0; i < NUM_SPILL_FILES; i++) {
+      spill_files.push_back(CreateSpillFile());
+    }
+  }
+  for (PendingMates::const_iterator it = pending.begin();
+       it != pending.end(); ++it) {
+    WriteSpillRecord(spill_files[HashName(it->first) % spill_files.size()],
+                     it->second);
+  }
+  num_spilled += pending.size();
+  stringstream msg;
+  msg << "Spilled " << pending.size() << " unpaired mates to temporary files ("
+      << num_spilled << " in total)";
+  PrintMessageDieOnError(msg.str(), PROGRESS);
+  pending.clear();
+}
+
+void BamCollatingFileReader::WriteSpillRecord(FILE* file,
+                                              const BamRecord& spilled) {
+  uint32_t lengths[2] = {static_cast<uint32_t>(spilled.name.size()),
+                         static_cast<uint32_t>(spilled.bases.size())};
+  if (fwrite(&spilled.flag, sizeof(spilled.flag), 1, file) != 1 ||
+      fwrite(lengths, sizeof(lengths), 1, file) != 1 ||
+      fwrite(spilled.name.data(), 1, lengths[0], file) != lengths[0] ||
+      fwrite(spilled.bases.data(), 1, lengths[1], file) != lengths[1] ||
+      fwrite(spilled.qualities.data(), 1, lengths[1], file) != lengths[1]) {
+    PrintMessageDieOnError("Could not write to temporary file", ERROR);
+  }
+}
+
+bool BamCollatingFileReader::ReadSpillRecord(FILE* file, BamRecord* spilled) {
+  uint32_t lengths[2];
+  if (fread(&spilled->flag, sizeof(spilled->flag), 1, file) != 1) {
+    return false;
+  }
+  if (fread(lengths, sizeof(lengths), 1, file) != 1) {
+    PrintMessageDieOnError("Could not read temporary file", ERROR);
+  }
+  spilled->name.resize(lengths[0]);
+  spilled->bases.resize(lengths[1]);
+  spilled->qualities.resize(lengths[1]);
+  // Empty strings have no buffer to read into
+  if ((lengths[0] > 0 &&
+       fread(&spilled->name[0], 1, lengths[0], file) != lengths[0]) ||
+      (lengths[1] > 0 &&
+       (fread(&spilled->bases[0], 1, lengths[1], file) != lengths[1] ||
+        fread(&spilled->qualities[0], 1, lengths[1], file) != lengths[1]))) {
+    PrintMessageDieOnError("Could not read temporary file", ERROR);
+  }
+  return true;
+}
@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_BAMCOLLATINGFILEREADER_H__
+#define SRC_BAMCOLLATINGFILEREADER_H__
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/BamRecordReader.h"
+#include "src/TextFileReader.h"
+
+/*
+  Paired-end reader for bam files in any order, e.g. sorted by
+  coordinate (--bampair --collate-pairs). Mates wait in a table keyed
+  by read name until the other mate is read. When the table holds more
+  than collate_max_pending reads, its contents are spilled to temporary
+  files, partitioned by a hash of the read name. After the end of the
+  bam file each partition is read back and paired on its own. Mates
+  that are never matched are returned as single reads.
+ */
+class BamCollatingFileReader : public TextFileReader {
+ public:
+  explicit BamCollatingFileReader(const std::string& _filename="");
+  virtual ~BamCollatingFileReader();
+  virtual bool GetNextRecord(ReadPair* read_pair);
+  virtual bool GetNextRead(MSReadRecord* read);
+
+ private:
+  typedef std::map<std::string, BamRecord> PendingMates;
+  static const int NUM_SPILL_FILES = 64;
+
+  bool GetNextBamRecord();
+  void SpillPending();
+  void WriteSpillRecord(FILE* file, const BamRecord& spilled);
+  bool ReadSpillRecord(FILE* file, BamRecord* spilled);
+  static FILE* CreateSpillFile();
+
+  // Owned. Reads the whole file, or only STR regions (--str-regions)
+  IBamRecordSource* reader;
+  // Kept between reads to reuse its memory
+  BamRecord record;
+  PendingMates pending;
+  std::vector<FILE*> spill_files;
+  // Spill file being paired, -1 while reading the bam file
+  int current_spill;
+  // Set once the current input is exhausted: the mates left
+  // pending are returned as single reads
+  bool draining;
+  size_t num_spilled;
+  size_t num_orphans;
+};
+
+#endif  // SRC_BAMCOLLATINGFILEREADER_H__
@@ -22,46 +22,51 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 
-#include "api/BamReader.h"
 #include "src/BamFileReader.h"
 #include "src/common.h"
 #include "src/runtime_parameters.h"
-
-using BamTools::BamReader;
-using BamTools::BamAlignment;
+#include "src/STRPrescreen.h"
 
 using namespace std;
-BamFileReader::BamFileReader(const std::string& _filename) {
-  if (!reader.Open(_filename)) {
-    PrintMessageDieOnError("Could not open bam file", ERROR);
-  }
+BamFileReader::BamFileReader(const std::string& _filename)
+  : reader(create_bam_record_source(_filename)) {}
+
+BamFileReader::~BamFileReader() {
+  delete reader;
 }
 
 bool BamFileReader::GetNextRecord(ReadPair* read_pair) {
-  read_pair->reads.clear();
-  MSReadRecord single_read;
-  if (GetNextRead(&single_read)) {
-    read_pair->reads.push_back(single_read);
-    return true;
-  } else {
-    return false;
-  }
+  // Fill the first read in place, so its strings keep their memory
+  read_pair->reads.resize(1);
+  return GetNextRead(&read_pair->reads[0]);
 }
 
 bool BamFileReader::GetNextRead(MSReadRecord* read) {
-  BamAlignment aln;
   // check if any lines left
-  if (!reader.GetNextAlignment(aln)) {
+  if (!reader->GetNextRecord(&record)) {
     return false;
   }
-  read->ID = aln.Name;
-  string trim_nucs;
-  string trim_qual;
-  TrimRead(aln.QueryBases, aln.Qualities, &trim_nucs, &trim_qual, QUAL_CUTOFF);
-  read->nucleotides = trim_nucs;
-  read->quality_scores = trim_qual;
-  read->orig_nucleotides = trim_nucs;
-  read->orig_qual = trim_qual;
-  read->paired = false;
+  trimmed_length = TrimmedReadLength(record.qualities.data(),
+                                     record.qualities.size(), QUAL_CUTOFF);
+  // Reads that can not pass detection are not filled in
+  bool screened_out = (prescreen_reads &&
+                       !PrescreenRead(record.bases.data(), trimmed_length));
+  if (screened_out && !prescreen_check) {
+    read->Reset();
+    read->prescreen_failed = true;
+    return true;
+  }
+  FillRead(read);
+  read->prescreen_failed = screened_out;
   return true;
 }
+
+void BamFileReader::FillRead(MSReadRecord* read) {
+  read->Reset();
+  read->ID = record.name;
+  read->nucleotides.assign(record.bases, 0, trimmed_length);
+  read->quality_scores.assign(record.qualities, 0, trimmed_length);
+  read->orig_nucleotides = read->nucleotides;
+  read->orig_qual = read->quality_scores;
+  read->paired = false;
+}
@@ -23,20 +23,22 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 
-#include "src/api/BamReader.h"
+#include "src/BamRecordReader.h"
 #include "src/TextFileReader.h"
 
-namespace BamTools {
-  class BamReader;
-}
-
 class BamFileReader : public TextFileReader {
  public:
   explicit BamFileReader(const std::string& _filename="");
+  virtual ~BamFileReader();
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
  private:
-  BamTools::BamReader reader;
+  // Owned. Reads the whole file, or only STR regions (--str-regions)
+  IBamRecordSource* reader;
+  // Kept between reads to reuse its memory
+  BamRecord record;
+  size_t trimmed_length;
+  void FillRead(MSReadRecord* read);
 };
 
 #endif  // SRC_BAMFILEREADER_H__
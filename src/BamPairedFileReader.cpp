@@ -27,42 +27,34 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include "src/common.h"
 #include "src/BamPairedFileReader.h"
 #include "src/runtime_parameters.h"
-
-using BamTools::BamReader;
-using BamTools::BamAlignment;
+#include "src/STRPrescreen.h"
 
 using namespace std;
 
-BamPairedFileReader::BamPairedFileReader(const std::string& _filename) {
-  if (!reader.Open(_filename)) {
-    PrintMessageDieOnError("Could not open bam file", ERROR);
-  }
-}
+BamPairedFileReader::BamPairedFileReader(const std::string& _filename)
+  : reader(_filename),
+    record_pending(false) {}
 
 
 bool BamPairedFileReader::GetNextRecord(ReadPair* read_pair) {
-  read_pair->reads.clear();
-  MSReadRecord single_read;
-  MSReadRecord mate;
-  int64_t bam_file_position;
-  if (GetNextRead(&single_read)) {
-    read_pair->reads.push_back(single_read);
-    if (!single_read.paired) {
+  // Fill the reads in place, so their strings keep their memory
+  read_pair->reads.resize(1);
+  if (GetNextRead(&read_pair->reads[0])) {
+    if (!read_pair->reads[0].paired) {
       return true;
     } else {
-      if (GetNextReadMate(&mate, &bam_file_position)) {
-        if (mate.ID == single_read.ID) {
-          read_pair->reads.push_back(mate);
+      read_pair->reads.resize(2);
+      if (GetNextReadMate(&read_pair->reads[1])) {
+        if (read_pair->reads[1].ID == read_pair->reads[0].ID) {
           return true;
         } else {
-          PrintMessageDieOnError("Could not find pair for " + single_read.ID +
+          PrintMessageDieOnError("Could not find pair for " + read_pair->reads[0].ID +
                                  ". Is the bam file sorted by read name?", WARNING);
           // set single read to not paired
+          read_pair->reads.resize(1);
           read_pair->reads.at(0).paired = false;
           // back up by one read
-          if (!reader.Seek(bam_file_position)) {
-            PrintMessageDieOnError("Could not rewind bam file reader", ERROR);
-          }
+          record_pending = true;
           return true;
         }
       }
@@ -73,67 +65,73 @@ bool BamPairedFileReader::GetNextRecord(ReadPair* read_pair) {
   return false;
 }
 
-bool BamPairedFileReader::GetNextReadMate(MSReadRecord* read,
-                                          int64_t* bam_file_position) {
-  // Get position in case we need to rewind
-  *bam_file_position = reader.Tell();
-  BamAlignment aln;
+bool BamPairedFileReader::GetNextBamRecord() {
+  if (record_pending) {
+    record_pending = false;
+    return true;
+  }
+  return reader.GetNextRecord(&record);
+}
+
+bool BamPairedFileReader::GetNextReadMate(MSReadRecord* read) {
   // check if any lines left
-  if (!reader.GetNextAlignment(aln)) {
+  if (!GetNextBamRecord()) {
     return false;
   }
-  read->ID = aln.Name;
-  // strip /1 or /2 for pairs
-  if (read->ID.length() > 2) {
-    int pos1 = read->ID.find("/1");
-    int pos2 = read->ID.find("/2");
-    if (pos1 != -1) {
-      read->ID = read->ID.substr(0, pos1);
-    } else if (pos2 != -1) {
-      read->ID = read->ID.substr(0, pos2);
-    }
-  }
-  string nucs = aln.QueryBases;
-  string qual = aln.Qualities;
-  nucs = reverseComplement(nucs);
-  qual = reverse(qual);
-  string trim_nucs;
-  string trim_qual;
-  TrimRead(nucs, qual, &trim_nucs, &trim_qual, QUAL_CUTOFF);
-  read->nucleotides = trim_nucs;
-  read->quality_scores = trim_qual;
-  read->orig_nucleotides = trim_nucs;
-  read->orig_qual = trim_qual;
-  read->paired = aln.IsPaired();
+  FillRead(record, true, read);
   return true;
 }
 
 bool BamPairedFileReader::GetNextRead(MSReadRecord* read) {
-  BamAlignment aln;
   // check if any lines left
-  if (!reader.GetNextAlignment(aln)) {
+  if (!GetNextBamRecord()) {
     return false;
   }
-  read->ID = aln.Name;
+  FillRead(record, false, read);
+  return true;
+}
+
+string BamPairedFileReader::MateName(const string& name) {
   // strip /1 or /2 for pairs
-  if (read->ID.length() > 2) {
-    int pos1 = read->ID.find("/1");
-    int pos2 = read->ID.find("/2");
+  if (name.length() > 2) {
+    int pos1 = name.find("/1");
+    int pos2 = name.find("/2");
     if (pos1 != -1) {
-      read->ID = read->ID.substr(0, pos1);
+      return name.substr(0, pos1);
     } else if (pos2 != -1) {
-      read->ID = read->ID.substr(0, pos2);
+      return name.substr(0, pos2);
     }
   }
-  string nucs = aln.QueryBases;
-  string qual = aln.Qualities;
-  string trim_nucs;
-  string trim_qual;
-  TrimRead(nucs, qual, &trim_nucs, &trim_qual, QUAL_CUTOFF);
-  read->nucleotides = trim_nucs;
-  read->quality_scores = trim_qual;
-  read->orig_nucleotides = trim_nucs;
-  read->orig_qual = trim_qual;
-  read->paired = aln.IsPaired();
-  return true;
+  return name;
+}
+
+void BamPairedFileReader::FillRead(const BamRecord& record, bool is_mate,
+                                   MSReadRecord* read) {
+  read->Reset();
+  read->ID = MateName(record.name);
+  size_t length = record.bases.size();
+  if (is_mate) {
+    // The mate is reverse complemented. record is left untouched, in
+    // case it has to be read again
+    read->nucleotides.resize(length);
+    for (size_t i = 0; i < length; i++) {
+      read->nucleotides[i] = complement(record.bases[length - 1 - i]);
+    }
+    read->quality_scores.assign(record.qualities.rbegin(),
+                                record.qualities.rend());
+  } else {
+    read->nucleotides = record.bases;
+    read->quality_scores = record.qualities;
+  }
+  size_t trimmed_length = TrimmedReadLength(read->quality_scores.data(),
+                                            length, QUAL_CUTOFF);
+  read->nucleotides.resize(trimmed_length);
+  read->quality_scores.resize(trimmed_length);
+  read->orig_nucleotides = read->nucleotides;
+  read->orig_qual = read->quality_scores;
+  read->paired = record.IsPaired();
+  // Both mates are always filled, as the pair is matched by ID
+  read->prescreen_failed = (prescreen_reads &&
+                            !PrescreenRead(read->nucleotides.data(),
+                                           trimmed_length));
 }
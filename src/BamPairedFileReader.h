@@ -23,22 +23,29 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 
-#include "src/api/BamReader.h"
+#include "src/BamRecordReader.h"
 #include "src/TextFileReader.h"
 
-namespace BamTools {
-  class BamReader;
-}
-
 class BamPairedFileReader : public TextFileReader {
  public:
   explicit BamPairedFileReader(const std::string& _filename="");
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
+  // Read name with any /1 or /2 mate suffix removed
+  static std::string MateName(const std::string& name);
+  // Build a read from a record. A mate is reverse complemented
+  static void FillRead(const BamRecord& record, bool is_mate,
+                       MSReadRecord* read);
 
  private:
-  BamTools::BamReader reader;
-  bool GetNextReadMate(MSReadRecord* read, int64_t* bam_file_position);
+  BamRecordReader reader;
+  // Kept between reads to reuse its memory
+  BamRecord record;
+  // Set when record was read as a mate but did not match the read
+  // before it, so it is returned again as the next read
+  bool record_pending;
+  bool GetNextBamRecord();
+  bool GetNextReadMate(MSReadRecord* read);
 };
 
 #endif  // SRC_BAMPAIREDFILEREADER_H__
@@ -0,0 +1,148 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <string.h>
+
+#include <string>
+
+#include "src/api/BamAux.h"
+#include "src/api/BamConstants.h"
+#include "src/BamRecordReader.h"
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+
+using namespace std;
+namespace Constants = BamTools::Constants;
+
+namespace {
+// Letters of the two bases packed into each byte of a BAM sequence
+struct BasePairTable {
+  char pairs[256][2];
+  BasePairTable() {
+    for (int i = 0; i < 256; i++) {
+      pairs[i][0] = Constants::BAM_DNA_LOOKUP[i >> 4];
+      pairs[i][1] = Constants::BAM_DNA_LOOKUP[i & 0xf];
+    }
+  }
+};
+const BasePairTable base_pair_table;
+}  // namespace
+
+BamRecordReader::BamRecordReader(const std::string& _filename)
+  : filename(_filename),
+    // BAM files are BGZF, inflated on as many threads as there are workers
+    input(_filename.c_str(), static_cast<int>(threads)) {
+  if (!input) {
+    PrintMessageDieOnError("Could not open bam file", ERROR);
+  }
+  // Skip the header: magic, SAM text and reference sequences
+  if (!ReadBytes(Constants::BAM_HEADER_MAGIC_LENGTH) ||
+      memcmp(&buffer[0], Constants::BAM_HEADER_MAGIC,
+             Constants::BAM_HEADER_MAGIC_LENGTH) != 0) {
+    PrintMessageDieOnError("Could not open bam file " + filename +
+                           ": not a bam file", ERROR);
+  }
+  int32_t length, num_refs;
+  bool ok = (ReadInt32(&length) && length >= 0 && ReadBytes(length) &&
+             ReadInt32(&num_refs) && num_refs >= 0);
+  for (int32_t i = 0; ok && i < num_refs; i++) {
+    // name, then the reference length
+    ok = (ReadInt32(&length) && length >= 0 && ReadBytes(length + 4));
+  }
+  if (!ok) {
+    PrintMessageDieOnError("Could not read header of bam file " + filename,
+                           ERROR);
+  }
+}
+
+bool BamRecordReader::ReadInt32(int32_t* value) {
+  char data[4];
+  if (!input.read(data, 4)) return false;
+  uint32_t unsigned_value = BamTools::UnpackUnsignedInt(data);
+  if (BamTools::SystemIsBigEndian()) BamTools::SwapEndian_32(unsigned_value);
+  *value = static_cast<int32_t>(unsigned_value);
+  return true;
+}
+
+bool BamRecordReader::ReadBytes(size_t length) {
+  buffer.resize(length + 1);
+  input.read(&buffer[0], length);
+  return static_cast<size_t>(input.gcount()) == length;
+}
+
+bool BamRecordReader::GetNextRecord(BamRecord* record) {
+  int32_t block_length;
+  if (!ReadInt32(&block_length) || block_length == 0) {
+    return false;
+  }
+  if (block_length < Constants::BAM_CORE_SIZE ||
+      !ReadBytes(block_length)) {
+    PrintMessageDieOnError("Found truncated record in bam file " + filename,
+                           WARNING);
+    return false;
+  }
+  const char* core = &buffer[0];
+  bool big_endian = BamTools::SystemIsBigEndian();
+  uint32_t bin_mq_nl = BamTools::UnpackUnsignedInt(&core[8]);
+  uint32_t flag_nc = BamTools::UnpackUnsignedInt(&core[12]);
+  uint32_t seq_length = BamTools::UnpackUnsignedInt(&core[16]);
+  if (big_endian) {
+    BamTools::SwapEndian_32(bin_mq_nl);
+    BamTools::SwapEndian_32(flag_nc);
+    BamTools::SwapEndian_32(seq_length);
+  }
+  size_t name_length = bin_mq_nl & 0xff;
+  size_t num_cigar_ops = flag_nc & 0xffff;
+  record->flag = flag_nc >> 16;
+
+  // Variable length data: name, CIGAR (skipped), sequence, qualities
+  // and tags (skipped)
+  const char* data = core + Constants::BAM_CORE_SIZE;
+  size_t data_length = block_length - Constants::BAM_CORE_SIZE;
+  size_t seq_offset = name_length + num_cigar_ops * 4;
+  size_t qual_offset = seq_offset + (seq_length + 1) / 2;
+  if (qual_offset + seq_length > data_length) {
+    PrintMessageDieOnError("Found malformed record in bam file " + filename,
+                           ERROR);
+  }
+  // The name is null terminated
+  record->name.assign(data, strnlen(data, name_length));
+
+  record->bases.resize(seq_length);
+  const unsigned char* seq =
+    reinterpret_cast<const unsigned char*>(data + seq_offset);
+  for (size_t i = 0; i + 1 < seq_length; i += 2) {
+    const char* pair = base_pair_table.pairs[seq[i / 2]];
+    record->bases[i] = pair[0];
+    record->bases[i + 1] = pair[1];
+  }
+  if (seq_length % 2 == 1) {
+    record->bases[seq_length - 1] =
+      base_pair_table.pairs[seq[seq_length / 2]][0];
+  }
+
+  record->qualities.resize(seq_length);
+  const char* qual = data + qual_offset;
+  for (size_t i = 0; i < seq_length; i++) {
+    record->qualities[i] = static_cast<char>(qual[i] + 33);
+  }
+  return true;
+}
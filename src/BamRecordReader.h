@@ -0,0 +1,77 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_BAMRECORDREADER_H__
+#define SRC_BAMRECORDREADER_H__
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "src/ThreadedGzStream.h"
+
+// The fields of a BAM record lobSTR uses as input
+struct BamRecord {
+  std::string name;
+  // Bases as letters, qualities as FASTQ-style ASCII characters
+  std::string bases;
+  std::string qualities;
+  uint16_t flag;
+  bool IsPaired() const { return (flag & 0x1) != 0; }
+  void swap(BamRecord& other) {
+    name.swap(other.name);
+    bases.swap(other.bases);
+    qualities.swap(other.qualities);
+    std::swap(flag, other.flag);
+  }
+};
+
+// Source of the records of a bam file used as input
+class IBamRecordSource {
+ public:
+  virtual ~IBamRecordSource() {}
+  // Returns false when there are no records left
+  virtual bool GetNextRecord(BamRecord* record) = 0;
+};
+
+/*
+  Sequential reader for BAM files used as input reads. BGZF blocks are
+  inflated ahead of the reader on background threads, and of each
+  record only the name, flag, sequence and qualities are decoded:
+  CIGAR and tags are skipped without being parsed.
+ */
+class BamRecordReader : public IBamRecordSource {
+ public:
+  explicit BamRecordReader(const std::string& filename);
+  virtual bool GetNextRecord(BamRecord* record);
+
+ private:
+  bool ReadInt32(int32_t* value);
+  bool ReadBytes(size_t length);
+
+  std::string filename;
+  GzInputStream input;
+  // Raw data of the current record
+  std::vector<char> buffer;
+};
+
+#endif  // SRC_BAMRECORDREADER_H__
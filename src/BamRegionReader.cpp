@@ -0,0 +1,256 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/api/BamAux.h"
+#include "src/BamRegionReader.h"
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+#include "src/TextFileReader.h"
+
+using namespace std;
+using BamTools::BamAlignment;
+
+// Bin of the bam index holding the file offsets and read counts of
+// a whole reference, rather than chunks of reads
+static const uint32_t BAI_PSEUDO_BIN = 37450;
+
+// Supplementary alignments are not known to this version of BamTools
+static const uint16_t BAM_ALIGNMENT_SUPPLEMENTARY = 0x800;
+
+BamRegionReader::BamRegionReader(const std::string& _filename)
+  : filename(_filename),
+    next_window(0),
+    in_window(false),
+    state(READING_WINDOWS) {
+  if (!reader.Open(filename)) {
+    PrintMessageDieOnError("Could not open bam file", ERROR);
+  }
+  if (!reader.LocateIndex(BamTools::BamIndex::STANDARD)) {
+    PrintMessageDieOnError("--str-regions needs an index of bam file " +
+                           filename + " (samtools index)", ERROR);
+  }
+  LoadWindows();
+}
+
+int BamRegionReader::GetReferenceID(const std::string& chrom) {
+  // Allow for chromosome names with and without "chr"
+  int ref_id = reader.GetReferenceID(chrom);
+  if (ref_id == -1) {
+    if (chrom.compare(0, 3, "chr") == 0) {
+      ref_id = reader.GetReferenceID(chrom.substr(3));
+    } else {
+      ref_id = reader.GetReferenceID("chr" + chrom);
+    }
+  }
+  return ref_id;
+}
+
+void BamRegionReader::LoadWindows() {
+  // The merged reference lists the STRs of each reference chunk,
+  // with the name of its chromosome
+  TextFileReader tReader(index_prefix + "mergedref.bed");
+  string line;
+  size_t num_strs = 0;
+  while (tReader.GetNextLine(&line)) {
+    vector<string> items;
+    split(line, '\t', items);
+    if (items.size() != 4) {
+      PrintMessageDieOnError("Malformed merged reference file", ERROR);
+    }
+    int ref_id = GetReferenceID(items[0]);
+    if (ref_id == -1) continue;
+    vector<string> strs;
+    split(items[3], ';', strs);
+    for (size_t i = 0; i < strs.size(); i++) {
+      vector<string> str_items;
+      split(strs[i], '_', str_items);
+      if (str_items.size() < 2) continue;
+      Window window;
+      window.ref_id = ref_id;
+      window.start = max(0, atoi(str_items[0].c_str()) - str_region_padding);
+      window.end = min(atoi(str_items[1].c_str()) + str_region_padding,
+                       reader.GetReferenceData()[ref_id].RefLength);
+      windows.push_back(window);
+      num_strs++;
+    }
+  }
+  if (windows.empty()) {
+    PrintMessageDieOnError("None of the chromosomes of the lobSTR index are "
+                           "in bam file " + filename, WARNING);
+  }
+  // Merge overlapping windows, so no read is returned twice
+  sort(windows.begin(), windows.end());
+  size_t num_merged = 0;
+  for (size_t i = 0; i < windows.size(); i++) {
+    if (num_merged > 0 &&
+        windows[num_merged-1].ref_id == windows[i].ref_id &&
+        windows[num_merged-1].end >= windows[i].start) {
+      windows[num_merged-1].end = max(windows[num_merged-1].end,
+                                      windows[i].end);
+    } else {
+      windows[num_merged++] = windows[i];
+    }
+  }
+  windows.resize(num_merged);
+  int64_t window_bp = 0;
+  for (size_t i = 0; i < windows.size(); i++) {
+    window_bp += windows[i].end - windows[i].start;
+  }
+  stringstream msg;
+  msg << "Reading " << windows.size() << " regions around " << num_strs
+      << " STRs (" << window_bp << " bp) of bam file " << filename;
+  PrintMessageDieOnError(msg.str(), PROGRESS);
+}
+
+bool BamRegionReader::StartNextWindow() {
+  if (next_window == windows.size()) {
+    return false;
+  }
+  const Window& window = windows[next_window++];
+  if (!reader.SetRegion(window.ref_id, window.start,
+                        window.ref_id, window.end)) {
+    PrintMessageDieOnError("Could not read region of bam file " + filename +
+                           ": " + reader.GetErrorString(), ERROR);
+  }
+  return true;
+}
+
+bool BamRegionReader::FindUnplacedReads(int64_t* offset,
+                                        uint64_t* num_unplaced) {
+  // BamTools does not expose where the unplaced reads start. They
+  // follow the last read of any reference, whose offset is the
+  // largest chunk end in the bam index
+  string index_file = filename + ".bai";
+  if (!fexists(index_file.c_str()) && filename.size() > 4 &&
+      filename.compare(filename.size() - 4, 4, ".bam") == 0) {
+    index_file = filename.substr(0, filename.size() - 4) + ".bai";
+  }
+  ifstream index(index_file.c_str(), ios::binary);
+  char magic[4];
+  int32_t num_refs;
+  if (!index.read(magic, 4) || string(magic, 4) != "BAI\1" ||
+      !index.read(reinterpret_cast<char*>(&num_refs), 4)) {
+    return false;
+  }
+  *offset = 0;
+  for (int32_t ref = 0; ref < num_refs; ref++) {
+    int32_t num_bins;
+    if (!index.read(reinterpret_cast<char*>(&num_bins), 4)) return false;
+    for (int32_t b = 0; b < num_bins; b++) {
+      uint32_t bin;
+      int32_t num_chunks;
+      if (!index.read(reinterpret_cast<char*>(&bin), 4) ||
+          !index.read(reinterpret_cast<char*>(&num_chunks), 4)) {
+        return false;
+      }
+      for (int32_t c = 0; c < num_chunks; c++) {
+        uint64_t chunk[2];
+        if (!index.read(reinterpret_cast<char*>(chunk), 16)) return false;
+        // The second "chunk" of the pseudo-bin holds read counts
+        if (bin == BAI_PSEUDO_BIN && c > 0) continue;
+        *offset = max(*offset, static_cast<int64_t>(chunk[1]));
+      }
+    }
+    int32_t num_intervals;
+    if (!index.read(reinterpret_cast<char*>(&num_intervals), 4)) return false;
+    index.seekg(static_cast<streamoff>(num_intervals) * 8, ios::cur);
+  }
+  // Optional: number of unplaced reads
+  if (!index.read(reinterpret_cast<char*>(num_unplaced), 8)) {
+    *num_unplaced = 1;
+  }
+  return true;
+}
+
+bool BamRegionReader::StartUnplacedReads() {
+  int64_t offset;
+  uint64_t num_unplaced;
+  if (BamTools::SystemIsBigEndian() ||
+      !FindUnplacedReads(&offset, &num_unplaced)) {
+    PrintMessageDieOnError("Could not find unmapped reads in bam index of " +
+                           filename + ". They are skipped", WARNING);
+    return false;
+  }
+  if (num_unplaced == 0) {
+    return false;
+  }
+  // Rewinding clears the region
+  if (!reader.Rewind() || (offset > 0 && !reader.Seek(offset))) {
+    PrintMessageDieOnError("Could not seek in bam file " + filename, ERROR);
+  }
+  return true;
+}
+
+bool BamRegionReader::GetNextRecord(BamRecord* record) {
+  while (state != DONE) {
+    if (!in_window) {
+      if (state == READING_WINDOWS && StartNextWindow()) {
+        in_window = true;
+      } else if (state == READING_WINDOWS && StartUnplacedReads()) {
+        state = READING_UNPLACED;
+        in_window = true;
+      } else {
+        state = DONE;
+        break;
+      }
+    }
+    if (!reader.GetNextAlignmentCore(aln)) {
+      in_window = false;
+      if (state == READING_UNPLACED) state = DONE;
+      continue;
+    }
+    if (aln.AlignmentFlag & (BamTools::Constants::BAM_ALIGNMENT_SECONDARY |
+                             BAM_ALIGNMENT_SUPPLEMENTARY)) {
+      continue;
+    }
+    if (state == READING_UNPLACED) {
+      if (aln.RefID != -1) continue;
+    } else if (next_window > 1) {
+      // Returned with the previous window already
+      const Window& previous = windows[next_window-2];
+      if (aln.RefID == previous.ref_id && aln.Position < previous.end) {
+        continue;
+      }
+    }
+    aln.BuildCharData();
+    record->name = aln.Name;
+    record->flag = aln.AlignmentFlag;
+    // Reads on the reverse strand are turned back into the orientation
+    // they were sequenced in
+    if (aln.IsReverseStrand()) {
+      record->bases = reverseComplement(aln.QueryBases);
+      record->qualities = reverse(aln.Qualities);
+    } else {
+      record->bases = aln.QueryBases;
+      record->qualities = aln.Qualities;
+    }
+    return true;
+  }
+  return false;
+}
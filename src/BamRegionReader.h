@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_BAMREGIONREADER_H__
+#define SRC_BAMREGIONREADER_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "src/api/BamAlignment.h"
+#include "src/api/BamReader.h"
+#include "src/BamRecordReader.h"
+
+/*
+  Reads only the records of a coordinate-sorted, indexed bam file that
+  lie near an STR of the lobSTR index (--str-regions). Each STR is
+  padded by str_region_padding bp and overlapping windows are merged.
+  The windows are read in order through the bam index, a record that
+  overlaps two windows is returned once. Unmapped reads placed inside a
+  window come with it, and unmapped reads without a position, stored
+  at the end of the file, are read last.
+ */
+class BamRegionReader : public IBamRecordSource {
+ public:
+  explicit BamRegionReader(const std::string& filename);
+  virtual bool GetNextRecord(BamRecord* record);
+
+ private:
+  // 0-based, half-open
+  struct Window {
+    int ref_id;
+    int start;
+    int end;
+    bool operator<(const Window& other) const {
+      return (ref_id < other.ref_id ||
+              (ref_id == other.ref_id && start < other.start));
+    }
+  };
+  enum State {
+    READING_WINDOWS,
+    READING_UNPLACED,
+    DONE
+  };
+
+  void LoadWindows();
+  int GetReferenceID(const std::string& chrom);
+  bool StartNextWindow();
+  bool StartUnplacedReads();
+  bool FindUnplacedReads(int64_t* offset, uint64_t* num_unplaced);
+
+  std::string filename;
+  BamTools::BamReader reader;
+  // Kept between reads to reuse its memory
+  BamTools::BamAlignment aln;
+  std::vector<Window> windows;
+  // Index of the window after the one being read
+  size_t next_window;
+  bool in_window;
+  State state;
+};
+
+#endif  // SRC_BAMREGIONREADER_H__
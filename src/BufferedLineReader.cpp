@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "src/BufferedLineReader.h"
+
+using namespace std;
+
+const size_t LINE_READER_BUFFER_SIZE = 1024*1024;
+
+BufferedLineReader::BufferedLineReader(std::istream* _input)
+  : input(_input), begin(NULL), end(NULL), at_eof(false) {}
+
+BufferedLineReader::BufferedLineReader(const char* data, size_t length)
+  : input(NULL), begin(data), end(data + length), at_eof(true) {}
+
+size_t BufferedLineReader::GetLines(size_t num_lines, LineView* lines) {
+  while (1) {
+    const char* pos = begin;
+    size_t found = 0;
+    bool partial_line = false;
+    while (found < num_lines && pos < end) {
+      const char* newline = static_cast<const char*>(
+          memchr(pos, '\n', end - pos));
+      if (newline == NULL) {
+        if (!at_eof) {
+          partial_line = true;
+          break;
+        }
+        // Last line of the input, without a newline
+        newline = end;
+      }
+      lines[found].data = pos;
+      lines[found].length = newline - pos;
+      found++;
+      pos = (newline == end) ? end : newline + 1;
+    }
+    if (!partial_line && (found == num_lines || at_eof)) {
+      begin = pos;
+      return found;
+    }
+    // Not all lines are in the buffer. Read more and look again
+    if (!FillBuffer()) {
+      at_eof = true;
+    }
+  }
+}
+
+bool BufferedLineReader::FillBuffer() {
+  if (at_eof || input == NULL) return false;
+  size_t unconsumed = end - begin;
+  size_t offset = buffer.empty() ? 0 : begin - &buffer[0];
+  if (buffer.empty()) {
+    buffer.resize(LINE_READER_BUFFER_SIZE);
+  } else if (unconsumed >= buffer.size() / 2) {
+    // Grow for very long records, so each refill still reads a lot
+    buffer.resize(buffer.size() * 2);
+  }
+  if (unconsumed > 0) {
+    memmove(&buffer[0], &buffer[0] + offset, unconsumed);
+  }
+  size_t num = input->rdbuf()->sgetn(&buffer[0] + unconsumed,
+                                     buffer.size() - unconsumed);
+  begin = &buffer[0];
+  end = begin + unconsumed + num;
+  return num > 0;
+}
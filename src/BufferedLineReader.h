@@ -0,0 +1,64 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_BUFFEREDLINEREADER_H__
+#define SRC_BUFFEREDLINEREADER_H__
+
+#include <istream>
+#include <vector>
+
+// A line inside the reader's buffer. The newline is not included
+struct LineView {
+  const char* data;
+  size_t length;
+};
+
+/*
+  Splits input into lines without copying them out of its buffer.
+  Input is read in large blocks and line ends are found with memchr.
+  Lines are returned as views into the buffer, so callers copy only
+  the parts of a record they keep.
+ */
+class BufferedLineReader {
+ public:
+  // Read lines from a stream. The stream is not owned
+  explicit BufferedLineReader(std::istream* _input);
+  // Read lines from a block of memory, which must outlive the reader
+  BufferedLineReader(const char* data, size_t length);
+
+  // Get the next num_lines lines. Returns the number of lines found,
+  // which is less than num_lines only at the end of the input. All
+  // views stay valid until the next call.
+  size_t GetLines(size_t num_lines, LineView* lines);
+
+ private:
+  // Keep the unconsumed data and read more input behind it.
+  // Returns false at the end of the input
+  bool FillBuffer();
+
+  std::istream* input;
+  std::vector<char> buffer;
+  // Unconsumed data is [begin, end)
+  const char* begin;
+  const char* end;
+  bool at_eof;
+};
+
+#endif  // SRC_BUFFEREDLINEREADER_H__
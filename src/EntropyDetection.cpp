@@ -19,6 +19,10 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <math.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <algorithm>
 #include <string>
@@ -35,31 +39,143 @@ static double MinusPlogP(double value) {
   return -1 * value * log(value)/log(2);
 }
 
+// count*log2(count) in fixed point. Integer sums don't depend on the
+// order of additions, so windows with the same dinucleotide counts
+// always get the same entropy, as when counting each window on its own
+static const double COUNT_LOG_SCALE = 1099511627776.0;  // 2^40
+// Counts in a window are bounded by the window size, so all the logs
+// needed for windows of up to 257 bp are tabulated once
+static const int ENTROPY_TABLE_SIZE = 256;
+
+static int64_t ScaledCountLogCount(int count) {
+  if (count == 0) return 0;
+  return static_cast<int64_t>(floor(count * log(static_cast<double>(count))/log(2) *
+                                    COUNT_LOG_SCALE + 0.5));
+}
+
+struct EntropyTables {
+  EntropyTables() {
+    log2_count[0] = 0;
+    for (int i = 0; i < ENTROPY_TABLE_SIZE; ++i) {
+      count_log_count[i] = ScaledCountLogCount(i);
+      if (i > 0) log2_count[i] = log(static_cast<double>(i))/log(2);
+    }
+  }
+  int64_t count_log_count[ENTROPY_TABLE_SIZE];
+  double log2_count[ENTROPY_TABLE_SIZE];
+};
+
+static const EntropyTables& GetEntropyTables() {
+  static const EntropyTables tables;
+  return tables;
+}
+
+static int64_t CountLogCount(const EntropyTables& tables, int count) {
+  if (count < ENTROPY_TABLE_SIZE) {
+    return tables.count_log_count[count];
+  }
+  return ScaledCountLogCount(count);
+}
+
+static double Log2Count(const EntropyTables& tables, int count) {
+  if (count < ENTROPY_TABLE_SIZE) {
+    return tables.log2_count[count];
+  }
+  return log(static_cast<double>(count))/log(2);
+}
+
+// Bin of dinucleotides with an N, which are not counted
+static const unsigned char SKIPPED_DINUC_BIN = NUM_DINUC_BINS;
+
+// Base codes: A, C, G, T, anything else, N
+static const unsigned char NUC_N_CODE = 5;
+
+static unsigned char NucCode(char nuc) {
+  return nuc == 'N' ? NUC_N_CODE : nucToNumber(nuc);
+}
+
+/*
+  Set bins[j] to the histogram bin of the dinucleotide starting at
+  nucs[j], for all j < length-1. 16 dinucleotides are binned at a
+  time with SSE2.
+ */
+static void DinucBins(const char* nucs, size_t length, unsigned char* bins) {
+  size_t j = 0;
+#ifdef __SSE2__
+  const __m128i a = _mm_set1_epi8('A');
+  const __m128i c = _mm_set1_epi8('C');
+  const __m128i g = _mm_set1_epi8('G');
+  const __m128i t = _mm_set1_epi8('T');
+  const __m128i n = _mm_set1_epi8('N');
+  const __m128i skipped = _mm_set1_epi8(SKIPPED_DINUC_BIN);
+  for (; j + 17 <= length; j += 16) {
+    __m128i codes[2];
+    __m128i is_n[2];
+    for (int k = 0; k < 2; k++) {
+      __m128i nucs16 = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(nucs + j + k));
+      __m128i is_a = _mm_cmpeq_epi8(nucs16, a);
+      __m128i is_c = _mm_cmpeq_epi8(nucs16, c);
+      __m128i is_g = _mm_cmpeq_epi8(nucs16, g);
+      __m128i is_t = _mm_cmpeq_epi8(nucs16, t);
+      is_n[k] = _mm_cmpeq_epi8(nucs16, n);
+      __m128i is_other = _mm_or_si128(_mm_or_si128(is_a, is_c),
+                                      _mm_or_si128(is_g, is_t));
+      is_other = _mm_andnot_si128(_mm_or_si128(is_other, is_n[k]),
+                                  _mm_set1_epi8(-1));
+      codes[k] = _mm_or_si128(
+          _mm_or_si128(_mm_and_si128(is_c, _mm_set1_epi8(1)),
+                       _mm_and_si128(is_g, _mm_set1_epi8(2))),
+          _mm_or_si128(_mm_and_si128(is_t, _mm_set1_epi8(3)),
+                       _mm_and_si128(is_other, _mm_set1_epi8(4))));
+    }
+    // first + 5*second, or the skipped bin if either is an N
+    __m128i twice = _mm_add_epi8(codes[1], codes[1]);
+    __m128i bin16 = _mm_add_epi8(codes[0], _mm_add_epi8(
+        _mm_add_epi8(twice, twice), codes[1]));
+    __m128i has_n = _mm_or_si128(is_n[0], is_n[1]);
+    bin16 = _mm_or_si128(_mm_and_si128(has_n, skipped),
+                         _mm_andnot_si128(has_n, bin16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bins + j), bin16);
+  }
+#endif
+  for (; j + 1 < length; j++) {
+    unsigned char first = NucCode(nucs[j]);
+    unsigned char second = NucCode(nucs[j+1]);
+    if (first == NUC_N_CODE || second == NUC_N_CODE) {
+      bins[j] = SKIPPED_DINUC_BIN;
+    } else {
+      bins[j] = first + second*5;
+    }
+  }
+}
 
 EntropyDetection::EntropyDetection(const string& nucleotides,
                                    int size, int step) {
   _nucs = nucleotides;
   _window_size = size;
   _window_step = step;
+  _window_calculated = false;
+  _max_entropy = 0;
 }
 
 EntropyDetection::~EntropyDetection() {}
 
 double EntropyDetection::EntropyOneWindowDinuc(const std::string& window_nucs) {
   size_t window_length = window_nucs.length();
-  vector<int> kmer_counts(44, 0);
+  int kmer_counts[NUM_DINUC_BINS] = {0};
   float subseqs = 0;
   for (size_t i = 0; i < window_length - 2; ++i) {
     char nuc1 = window_nucs.at(i);
     char nuc2 = window_nucs.at(i+1);
     if (nuc1 != 'N' && nuc2 != 'N') {
-      kmer_counts[nucToNumber(nuc1) + nucToNumber(nuc2)*10] += 1;
+      kmer_counts[nucToNumber(nuc1) + nucToNumber(nuc2)*5] += 1;
       subseqs+= 1;
     }
   }
   float entropy = 0;
-  for (size_t i = 0; i < kmer_counts.size(); ++i) {
-    int count = kmer_counts.at(i);
+  for (int i = 0; i < NUM_DINUC_BINS; ++i) {
+    int count = kmer_counts[i];
     if (count !=0) {
       float p = static_cast<float>(count)/subseqs;
       entropy += MinusPlogP(p);
@@ -69,31 +185,71 @@ double EntropyDetection::EntropyOneWindowDinuc(const std::string& window_nucs) {
 }
 
 void EntropyDetection::CalculateEntropyWindow() {
+  if (_window_calculated) return;
+  _window_calculated = true;
   _entropy_window.clear();
-  string window_nucleotides = "";
+  if (_nucs.length() <= static_cast<size_t>(_window_size)) return;
+  const EntropyTables& tables = GetEntropyTables();
+  vector<unsigned char> bins(_nucs.length());
+  DinucBins(_nucs.data(), _nucs.length(), &bins[0]);
+  // Dinucleotide histogram of the current window, the skipped bin last
+  int counts[NUM_DINUC_BINS+1] = {0};
+  // Running sum of count*log2(count) over the bins, in fixed point
+  int64_t count_log_count = 0;
+  // Like EntropyOneWindowDinuc, a window of size w counts the
+  // dinucleotides starting in its first w-2 positions
+  const size_t window_dinucs = _window_size - 2;
+  // Dinucleotide start positions in the histogram: [begin, end)
+  size_t begin = 0;
+  size_t end = 0;
   for (size_t i = 0; i < _nucs.length() - _window_size; i += _window_step) {
-    window_nucleotides = _nucs.substr(i, _window_size);
-    double entropy = EntropyOneWindowDinuc(window_nucleotides);
+    if (i >= end) {
+      // No overlap with the previous window
+      fill(counts, counts + NUM_DINUC_BINS + 1, 0);
+      count_log_count = 0;
+      begin = end = i;
+    }
+    for (; begin < i; ++begin) {
+      int& count = counts[bins[begin]];
+      count_log_count -= CountLogCount(tables, count);
+      count--;
+      count_log_count += CountLogCount(tables, count);
+    }
+    for (; end < i + window_dinucs; ++end) {
+      int& count = counts[bins[end]];
+      count_log_count -= CountLogCount(tables, count);
+      count++;
+      count_log_count += CountLogCount(tables, count);
+    }
+    // -sum(p*log2(p)) = log2(n) - sum(c*log2(c))/n
+    int num_dinucs = (end - begin) - counts[SKIPPED_DINUC_BIN];
+    double entropy = 0;
+    if (num_dinucs > 0) {
+      entropy = Log2Count(tables, num_dinucs) -
+        (count_log_count - CountLogCount(tables, counts[SKIPPED_DINUC_BIN])) /
+        COUNT_LOG_SCALE / num_dinucs;
+    }
+    entropy = (4-entropy)/4;
     if (entropy > 0.8)
       entropy = 0;
     _entropy_window.push_back(entropy);
   }
+  _max_entropy = *max_element(_entropy_window.begin(), _entropy_window.end());
 }
 
 bool EntropyDetection::EntropyIsAboveThreshold() {
   CalculateEntropyWindow();
-  return *max_element(_entropy_window.begin(), _entropy_window.end()) >
-    entropy_threshold;
+  return _max_entropy > entropy_threshold;
 }
 
 float EntropyDetection::GetMaxEntropy() {
   CalculateEntropyWindow();
-  return *max_element(_entropy_window.begin(), _entropy_window.end());
+  return _max_entropy;
 }
 
 void EntropyDetection::FindStartEnd(size_t* start, size_t* end,
                                     bool* repetitive_end) {
-  const vector<double> entropy_window = _entropy_window;
+  const vector<double>& entropy_window = _entropy_window;
   vector<double>::const_iterator it = max_element(entropy_window.begin(),
                                                   entropy_window.end());
   size_t index_of_max = distance(entropy_window.begin(), it);
@@ -24,12 +24,17 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <vector>
 
+// Number of dinucleotide bins: A, C, G, T and anything else for each base
+const int NUM_DINUC_BINS = 25;
+
 class EntropyDetection {
  private:
   std::string _nucs;
   std::vector<double> _entropy_window;
   int _window_size;
   int _window_step;
+  bool _window_calculated;
+  double _max_entropy;
 
  public:
   EntropyDetection(const std::string& nucleotides, int size, int step);
@@ -37,7 +42,10 @@ class EntropyDetection {
   // dinuc entropy, not generalized but optimized
   double EntropyOneWindowDinuc(const std::string& window_nucs);
 
-  // vector of entropy values for each window
+  // vector of entropy values for each window. The dinucleotide
+  // histogram slides along the read, only the positions entering
+  // and leaving a window are counted. All logs come from tables,
+  // values match EntropyOneWindowDinuc within 1e-6
   void CalculateEntropyWindow();
 
   // determine if there is a window above the entropy threshold
@@ -22,46 +22,52 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/common.h"
 #include "src/FastaFileReader.h"
+#include "src/runtime_parameters.h"
+#include "src/STRPrescreen.h"
 
 using namespace std;
 
 FastaFileReader::FastaFileReader(const string& _filename)
   : TextFileReader(_filename) {}
 
+FastaFileReader::FastaFileReader(const char* data, size_t length,
+                                 const std::string& _filename,
+                                 size_t _first_line)
+  : TextFileReader(data, length, _filename, _first_line) {}
+
 bool FastaFileReader::GetNextRecord(ReadPair* read_pair) {
-  read_pair->reads.clear();
-  MSReadRecord single_read;
-  if (GetNextRead(&single_read)) {
-    read_pair->reads.push_back(single_read);
-    return true;
-  } else {
-    return false;
-  }
+  // Fill the first read in place, so its strings keep their memory
+  read_pair->reads.resize(1);
+  return GetNextRead(&read_pair->reads[0]);
 }
                                              
 bool FastaFileReader::GetNextRead(MSReadRecord* read) {
-  string ID;
-  string nuc;
+  // Lines of the record point into the input buffer. Only the parts
+  // we keep are copied into the read
+  LineView lines[2];
+  size_t num_lines = line_reader.GetLines(2, lines);
+  id_line = lines[0];
+  nuc_line = lines[1];
 
   // If no more lines, this is EOF
   current_line++;
-  if (!getline(input_stream, ID)) {
+  if (num_lines == 0) {
     return false;
   }
   // Minimal input validation
-  if (ID.empty()) {
+  if (id_line.length == 0) {
     stringstream msg;
     msg << "Found empty ID in FASTA file " << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  if (valid_nucleotides_string(ID)) {
+  if (valid_nucleotides_string(id_line.data, id_line.length)) {
     stringstream msg;
     msg << "Found multi-lined fasta sequence in file "
         << filename << " line " << current_line
         << " (requires single-lined FASTA)";
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  if (ID.at(0) != '>') {
+  if (id_line.data[0] != '>') {
     stringstream msg;
     msg << "Found Invalid FASTA ID in file "
         << filename << " line " << current_line
@@ -73,30 +79,52 @@ bool FastaFileReader::GetNextRead(MSReadRecord* read) {
   // This is a problematic FASTA file
   current_line++;
 
-  if (!getline(input_stream, nuc)) {
+  if (num_lines < 2) {
     stringstream msg;
     msg << "Problem reading nucleotide line from FASTA file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
 
-  if (nuc.empty()) {
+  if (nuc_line.length == 0) {
     stringstream msg;
     msg << "Found empty nucleotide line from FASTA file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  if (!valid_nucleotides_string(nuc)) {
+  if (!valid_nucleotides_string(nuc_line.data, nuc_line.length)) {
     stringstream msg;
     msg << "Found invalid nucleotide line from FASTA file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  read->ID = ID.substr(1);
-  read->nucleotides = nuc;
-  read->quality_scores = string(nuc.length(), 'N');
-  read->orig_nucleotides = nuc;
+  // Reads that can not pass detection are not filled in
+  bool screened_out = (prescreen_reads &&
+                       !PrescreenRead(nuc_line.data, nuc_line.length));
+  if (screened_out && !prescreen_check) {
+    read->Reset();
+    read->prescreen_failed = true;
+    return true;
+  }
+  FillRead(read);
+  read->prescreen_failed = screened_out;
+  return true;
+}
+
+void FastaFileReader::FillPrescreenedRead(MSReadRecord* read) {
+  // With prescreen_check, GetNextRead filled in the read already
+  if (read->prescreen_failed && !prescreen_check) {
+    FillRead(read);
+    read->prescreen_failed = true;
+  }
+}
+
+void FastaFileReader::FillRead(MSReadRecord* read) {
+  read->Reset();
+  read->ID.assign(id_line.data + 1, id_line.length - 1);
+  read->nucleotides.assign(nuc_line.data, nuc_line.length);
+  read->quality_scores.assign(nuc_line.length, 'N');
+  read->orig_nucleotides = read->nucleotides;
   read->orig_qual = read->quality_scores;
   read->paired = false;
-  return true;
 }
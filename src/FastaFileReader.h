@@ -29,8 +29,19 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 class FastaFileReader : public TextFileReader {
  public:
   explicit FastaFileReader(const std::string& _filename="");
+  // Read records from a block of memory, see TextFileReader
+  FastaFileReader(const char* data, size_t length,
+                  const std::string& _filename, size_t _first_line);
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
+  virtual void FillPrescreenedRead(MSReadRecord* read);
+
+ private:
+  // Fill read from the lines of the current record
+  void FillRead(MSReadRecord* read);
+  // Lines of the current record, pointing into the input buffer
+  LineView id_line;
+  LineView nuc_line;
 };
 
 #endif  // SRC_FASTAFILEREADER_H__
@@ -30,11 +30,18 @@ class FastaPairedFileReader : public IFileReader {
  public:
   FastaPairedFileReader(const std::string& _filename1="",
                         const std::string& _filename2="");
+  // Takes ownership of the two single-end readers
+  FastaPairedFileReader(IFileReader* reader1, IFileReader* reader2);
+  // Both mates from one reader, one after the other (--interleaved).
+  // Takes ownership of the reader
+  explicit FastaPairedFileReader(IFileReader* interleaved_reader);
+  virtual ~FastaPairedFileReader();
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
  private:
   IFileReader* _reader1;
   IFileReader* _reader2;
+  bool _interleaved;
 };
 
 #endif  // SRC_FASTAPAIREDFILEREADER_H__
@@ -30,7 +30,8 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 using namespace std;
 
 FastqPairedFileReader::FastqPairedFileReader(const string& _filename1,
-                                             const string& _filename2) {
+                                             const string& _filename2)
+  : _interleaved(false) {
   if (gzip) {
     _reader1 = new ZippedFastqFileReader(_filename1);
     _reader2 = new ZippedFastqFileReader(_filename2);
@@ -40,22 +41,49 @@ FastqPairedFileReader::FastqPairedFileReader(const string& _filename1,
   }
 }
 
+FastqPairedFileReader::FastqPairedFileReader(IFileReader* reader1,
+                                             IFileReader* reader2)
+  : _reader1(reader1), _reader2(reader2), _interleaved(false) {}
+
+FastqPairedFileReader::FastqPairedFileReader(IFileReader* interleaved_reader)
+  : _reader1(interleaved_reader), _reader2(interleaved_reader),
+    _interleaved(true) {}
+
+FastqPairedFileReader::~FastqPairedFileReader() {
+  delete _reader1;
+  if (!_interleaved) {
+    delete _reader2;
+  }
+}
+
 bool FastqPairedFileReader::GetNextRecord(ReadPair* read_pair) {
-  read_pair->reads.clear();
-  MSReadRecord read1;
-  MSReadRecord read2;
-  if (_reader1->GetNextRead(&read1)) {
-    read1.paired = true;
-    read_pair->reads.push_back(read1);
+  // Fill both reads in place, so their strings keep their memory
+  read_pair->reads.resize(2);
+  if (_reader1->GetNextRead(&read_pair->reads[0])) {
+    if (_interleaved) {
+      // Reading the second mate overwrites what the reader knows of
+      // the first, so it can not be filled in later
+      _reader1->FillPrescreenedRead(&read_pair->reads[0]);
+    }
+    read_pair->reads[0].paired = true;
   } else {
     return false;
   }
-  if (_reader2->GetNextRead(&read2)) {
-    read2.paired = true;
-    read_pair->reads.push_back(read2);
+  if (_reader2->GetNextRead(&read_pair->reads[1])) {
+    read_pair->reads[1].paired = true;
   } else {
     return false;
   }
+  // The pair is only dropped if the pre-screen rejected both mates
+  if (read_pair->reads[0].prescreen_failed &&
+      !read_pair->reads[1].prescreen_failed && !_interleaved) {
+    _reader1->FillPrescreenedRead(&read_pair->reads[0]);
+    read_pair->reads[0].paired = true;
+  } else if (read_pair->reads[1].prescreen_failed &&
+             !read_pair->reads[0].prescreen_failed) {
+    _reader2->FillPrescreenedRead(&read_pair->reads[1]);
+    read_pair->reads[1].paired = true;
+  }
   return true;
 }
 
@@ -29,11 +29,18 @@ class FastqPairedFileReader : public IFileReader {
  public:
   FastqPairedFileReader(const std::string& _filename1="",
                         const std::string& _filename2="");
+  // Takes ownership of the two single-end readers
+  FastqPairedFileReader(IFileReader* reader1, IFileReader* reader2);
+  // Both mates from one reader, one after the other (--interleaved).
+  // Takes ownership of the reader
+  explicit FastqPairedFileReader(IFileReader* interleaved_reader);
+  virtual ~FastqPairedFileReader();
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
  private:
   IFileReader* _reader1;
   IFileReader* _reader2;
+  bool _interleaved;
 };
 
 #endif  // SRC_FASTQPAIREDFILEREADER_H__
@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include <string>
+
+#include "src/bntseq.h"
+#include "src/common.h"
+#include "src/FlankFilter.h"
+#include "src/kmerfilter.h"
+
+using namespace std;
+
+FlankFilter::FlankFilter()
+  : _blocks(NULL), _num_blocks(0), _num_probes(0), _k(0) {}
+
+bool FlankFilter::Load(const string& filename) {
+  _blocks = NULL;
+  if (!_file.Open(filename, true)) {
+    return false;
+  }
+  if (_file.size() < sizeof(kmer_filter_header_t)) {
+    PrintMessageDieOnError("Malformed k-mer filter " + filename, WARNING);
+    return false;
+  }
+  kmer_filter_header_t header;
+  memcpy(&header, _file.data(), sizeof(header));
+  if (memcmp(header.magic, KMER_FILTER_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != KMER_FILTER_VERSION ||
+      header.k == 0 || header.k > KMER_FILTER_MAX_K ||
+      header.num_probes > KMER_FILTER_NUM_PROBES ||
+      header.num_blocks == 0 ||
+      (_file.size() - sizeof(header)) / (KMER_FILTER_BLOCK_WORDS * 8) <
+      header.num_blocks) {
+    PrintMessageDieOnError("Malformed k-mer filter " + filename, WARNING);
+    return false;
+  }
+  _num_blocks = header.num_blocks;
+  _num_probes = static_cast<int>(header.num_probes);
+  _k = header.k;
+  _blocks = reinterpret_cast<const uint64_t*>(_file.data() + sizeof(header));
+  return true;
+}
+
+bool FlankFilter::HasKmerHit(const char* nucs, size_t length) const {
+  const uint64_t mask = (_k == 32) ? ~0ULL : (1ULL << (2*_k)) - 1;
+  const int shift = 2*(_k-1);
+  uint64_t fwd = 0;
+  uint64_t rev = 0;
+  // number of ACGT bases in a row ending at i
+  size_t run = 0;
+  for (size_t i = 0; i < length; i++) {
+    const uint64_t c = nst_nt4_table[static_cast<unsigned char>(nucs[i])];
+    if (c > 3) {
+      run = 0;
+      continue;
+    }
+    fwd = ((fwd << 2) | c) & mask;
+    rev = (rev >> 2) | ((3 - c) << shift);
+    if (++run >= _k &&
+        kmer_filter_contains(_blocks, _num_blocks, _num_probes,
+                             fwd < rev ? fwd : rev)) {
+      return true;
+    }
+  }
+  return false;
+}
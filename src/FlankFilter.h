@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_FLANKFILTER_H__
+#define SRC_FLANKFILTER_H__
+
+#include <stdint.h>
+
+#include <string>
+
+#include "src/MappedFile.h"
+
+/*
+  The k-mer filter lobSTRIndex builds over the reference (see
+  kmerfilter.h), mapped read-only. A flank none of whose k-mers are
+  in the filter has no exact k-mer match in the reference, so the
+  aligner can skip its BWT search when the allowed edits could not
+  have broken every k-mer.
+ */
+class FlankFilter {
+ public:
+  FlankFilter();
+  // Returns false if the file is missing or is not a k-mer filter
+  bool Load(const std::string& filename);
+  bool loaded() const { return _blocks != NULL; }
+  size_t k() const { return _k; }
+  // True if any k-mer of nucs[0, length) may be in the reference.
+  // k-mers with a base other than ACGT are skipped
+  bool HasKmerHit(const char* nucs, size_t length) const;
+
+ private:
+  MappedFile _file;
+  const uint64_t* _blocks;
+  uint64_t _num_blocks;
+  int _num_probes;
+  size_t _k;
+};
+
+#endif  // SRC_FLANKFILTER_H__
@@ -31,6 +31,9 @@ class IFileReader {
   virtual bool GetNextRecord(ReadPair* read_pair) = 0;
   // Get next read from a file
   virtual bool GetNextRead(MSReadRecord* read) = 0;
+  // Fill in the read last returned by GetNextRead if the STR pre-screen
+  // left it empty. Needed for pairs where only one mate was rejected
+  virtual void FillPrescreenedRead(MSReadRecord* /* read */) { }
 };
 
 #endif  // SRC_IFILEREADER_H__
@@ -49,13 +49,19 @@ class MSReadRecord {
   int ms_start;
   // location in the read whre the STR ends
   int ms_end;
-  // left flanking nucleotides
-  std::string left_flank_nuc;
+  // Detection records offsets rather than copies of the read. After
+  // detection nucleotides holds the read trimmed to the two flanks and
+  // the STR, the left flank starting at nucleotides[0] and the right
+  // flank ending at the end of nucleotides.
+  // length of the left flanking region
+  int left_flank_length;
   int left_flank_index_from_start;
-  // STR nucleotides (detected by STRDetector.cpp)
-  std::string detected_ms_region_nuc;
-  // right flanking nucleotides
-  std::string  right_flank_nuc;
+  // STR region detected by STRDetector.cpp, as an offset and a length
+  // in orig_nucleotides
+  int detected_ms_region_start;
+  int detected_ms_region_length;
+  // length of the right flanking region
+  int right_flank_length;
   int right_flank_index_from_end;
 
   // *** set during alignment *** //
@@ -105,6 +111,58 @@ class MSReadRecord {
   std::string  detected_ms_nuc;
   // is the read paired?
   bool paired;
+  // set by the reader if STRPrescreen rejected the read. Unless
+  // prescreen_check is set, the read is left empty
+  bool prescreen_failed;
+
+  // Flank nucleotides, copied out of the read for debug messages
+  std::string LeftFlankNucleotides() const {
+    return nucleotides.substr(0, left_flank_length);
+  }
+  std::string RightFlankNucleotides() const {
+    return nucleotides.substr(nucleotides.size() - right_flank_length);
+  }
+
+  /* Clear all fields so the record can be filled with another read.
+     Strings are cleared rather than replaced to keep their memory */
+  void Reset() {
+    ID.clear();
+    nucleotides.clear();
+    quality_scores.clear();
+    orig_nucleotides.clear();
+    orig_qual.clear();
+    ms_start = 0;
+    ms_end = 0;
+    left_flank_length = 0;
+    left_flank_index_from_start = 0;
+    detected_ms_region_start = 0;
+    detected_ms_region_length = 0;
+    right_flank_length = 0;
+    right_flank_index_from_end = 0;
+    repseq.clear();
+    orig_start = 0;
+    reverse = false;
+    chrom.clear();
+    strid = 0;
+    msStart = 0;
+    msEnd = 0;
+    refCopyNum = 0;
+    lStart = 0;
+    lEnd = 0;
+    rStart = 0;
+    rEnd = 0;
+    diffFromRef = 0;
+    name.clear();
+    mapq = 0;
+    edit_dist = 0;
+    cigar.clear();
+    cigar_string.clear();
+    read_start = 0;
+    read_end = 0;
+    detected_ms_nuc.clear();
+    paired = false;
+    prescreen_failed = false;
+  }
 };
 
 #endif  // SRC_MSREADRECORD_H_
@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "src/MappedFile.h"
+
+using namespace std;
+
+MappedFile::MappedFile()
+  : _data(NULL), _size(0), _mapped(false) {}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const string& filename, bool random_access) {
+  Close();
+  // Pipes are not even opened: closing the read end again could make
+  // the writer fail
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  // Files too large for the address space are read as a stream
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      static_cast<unsigned long long>(st.st_size) >
+      static_cast<unsigned long long>(static_cast<size_t>(-1))) {
+    close(fd);
+    return false;
+  }
+  _size = static_cast<size_t>(st.st_size);
+  // mmap() does not accept empty mappings
+  if (_size > 0) {
+    void* addr = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      close(fd);
+      _size = 0;
+      return false;
+    }
+    _data = static_cast<char*>(addr);
+    madvise(_data, _size, random_access ? MADV_WILLNEED : MADV_SEQUENTIAL);
+  }
+  close(fd);
+  _mapped = true;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (!_mapped) return;
+  if (_data != NULL) {
+    munmap(_data, _size);
+  }
+  _data = NULL;
+  _size = 0;
+  _mapped = false;
+}
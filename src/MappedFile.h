@@ -0,0 +1,53 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_MAPPEDFILE_H__
+#define SRC_MAPPEDFILE_H__
+
+#include <string>
+
+/*
+  Read-only memory mapping of a whole file. By default the kernel is
+  told the mapping is read sequentially, so it reads ahead aggressively
+  and drops pages behind the reader. Random access mappings are
+  instead paged in as a whole in the background.
+ */
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+  // Returns false if the file can not be mapped, e.g. because it
+  // is a pipe rather than a regular file
+  bool Open(const std::string& filename, bool random_access = false);
+  void Close();
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+
+ private:
+  // Not copyable, the mapping is owned
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  char* _data;
+  size_t _size;
+  bool _mapped;
+};
+
+#endif  // SRC_MAPPEDFILE_H__
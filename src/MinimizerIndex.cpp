@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "src/bntseq.h"
+#include "src/common.h"
+#include "src/MinimizerIndex.h"
+
+using namespace std;
+
+// Flanks up to this long are sketched without a heap allocation
+const int SKETCH_STACK_LENGTH = 256;
+
+MinimizerIndex::MinimizerIndex()
+  : _buckets(NULL), _hashes(NULL), _positions(NULL), _k(0), _w(0),
+    _bucket_shift(0) {}
+
+bool MinimizerIndex::Load(const string& filename) {
+  _positions = NULL;
+  if (!_file.Open(filename, true)) {
+    return false;
+  }
+  if (_file.size() < sizeof(mz_index_header_t)) {
+    PrintMessageDieOnError("Malformed minimizer index " + filename, WARNING);
+    return false;
+  }
+  mz_index_header_t header;
+  memcpy(&header, _file.data(), sizeof(header));
+  const uint64_t num_buckets = 1ULL << header.bucket_bits;
+  // buckets, hashes padded to 8 bytes, positions
+  const uint64_t body_words = (num_buckets + 1) +
+    (header.num_entries + 1) / 2 + header.num_entries;
+  if (memcmp(header.magic, MZ_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != MZ_INDEX_VERSION ||
+      header.k == 0 || header.k > MZ_INDEX_MAX_K ||
+      header.w == 0 || header.w > MZ_INDEX_MAX_W ||
+      header.bucket_bits == 0 || header.bucket_bits > 2*header.k ||
+      (_file.size() - sizeof(header)) / 8 < body_words) {
+    PrintMessageDieOnError("Malformed minimizer index " + filename, WARNING);
+    return false;
+  }
+  _k = static_cast<int>(header.k);
+  _w = static_cast<int>(header.w);
+  _bucket_shift = static_cast<int>(2*header.k - header.bucket_bits);
+  _buckets = reinterpret_cast<const uint64_t*>(_file.data() + sizeof(header));
+  _hashes = reinterpret_cast<const uint32_t*>(_buckets + num_buckets + 1);
+  _positions = reinterpret_cast<const uint64_t*>(_buckets + num_buckets + 1 +
+                                                 (header.num_entries + 1) / 2);
+  return true;
+}
+
+void MinimizerIndex::Sketch(const char* nucs, int length,
+                            vector<mz_t>* minimizers) const {
+  uint8_t stack_seq[SKETCH_STACK_LENGTH];
+  vector<uint8_t> heap_seq;
+  uint8_t* seq = stack_seq;
+  if (length > SKETCH_STACK_LENGTH) {
+    heap_seq.resize(length);
+    seq = &heap_seq[0];
+  }
+  for (int i = 0; i < length; i++) {
+    seq[i] = nst_nt4_table[static_cast<unsigned char>(nucs[i])];
+  }
+  minimizers->resize(length + 1);
+  const int num = (length > 0) ?
+    mz_sketch(seq, length, _k, _w, &(*minimizers)[0]) : 0;
+  minimizers->resize(num);
+}
+
+size_t MinimizerIndex::Lookup(uint32_t hash, const uint64_t** positions) const {
+  const uint64_t bucket = hash >> _bucket_shift;
+  const uint32_t* begin = _hashes + _buckets[bucket];
+  const uint32_t* end = _hashes + _buckets[bucket+1];
+  pair<const uint32_t*, const uint32_t*> range = equal_range(begin, end, hash);
+  *positions = _positions + (range.first - _hashes);
+  return range.second - range.first;
+}
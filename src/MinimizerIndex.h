@@ -0,0 +1,63 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_MINIMIZERINDEX_H__
+#define SRC_MINIMIZERINDEX_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "src/MappedFile.h"
+#include "src/mzindex.h"
+
+/*
+  The minimizer index lobSTRIndex builds over the reference (see
+  mzindex.h), mapped read-only. --seeder minimizer looks up the
+  minimizers of a flank here to find where in which reference
+  sequence it may align, instead of searching the BWT.
+ */
+class MinimizerIndex {
+ public:
+  MinimizerIndex();
+  // Returns false if the file is missing or is not a minimizer index
+  bool Load(const std::string& filename);
+  bool loaded() const { return _positions != NULL; }
+  int k() const { return _k; }
+  int w() const { return _w; }
+  // Minimizers of nucs[0, length), in the order they occur. Bases
+  // other than ACGT break k-mers
+  void Sketch(const char* nucs, int length, std::vector<mz_t>* minimizers) const;
+  // Reference positions of a minimizer hash, seqid << 32 |
+  // offset << 1 | strand. Returns the number of positions
+  size_t Lookup(uint32_t hash, const uint64_t** positions) const;
+
+ private:
+  MappedFile _file;
+  const uint64_t* _buckets;
+  const uint32_t* _hashes;
+  const uint64_t* _positions;
+  int _k;
+  int _w;
+  int _bucket_shift;
+};
+
+#endif  // SRC_MINIMIZERINDEX_H__
@@ -19,30 +19,77 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <err.h>
+
+#include <algorithm>
 #include <iostream>
 
 #include "src/common.h"
 #include "src/MultithreadData.h"
 
-MultithreadData::MultithreadData(int _slots)
-: items_to_process(_slots), items_to_output(_slots),
+ReadPairPool::ReadPairPool() {
+  if (pthread_mutex_init(&pool_access, NULL)!=0)
+	err(1,"ReadPairPool::ctor(): pthread_mutex_init() failed");
+}
+
+ReadPairPool::~ReadPairPool() {
+  for (size_t i = 0; i < free_pairs.size(); i++) {
+    delete free_pairs[i];
+  }
+}
+
+void ReadPairPool::get(size_t num_pairs, std::vector<ReadPair*>* pairs) {
+  if (pthread_mutex_lock(&pool_access)!=0)
+	err(1,"ReadPairPool::get(): pthread_mutex_lock() failed");
+  size_t num_reused = std::min(num_pairs, free_pairs.size());
+  pairs->insert(pairs->end(), free_pairs.end() - num_reused, free_pairs.end());
+  free_pairs.resize(free_pairs.size() - num_reused);
+  if (pthread_mutex_unlock(&pool_access)!=0)
+	err(1,"ReadPairPool::get(): pthread_mutex_unlock() failed");
+  for (size_t i = num_reused; i < num_pairs; i++) {
+    pairs->push_back(new ReadPair);
+  }
+}
+
+void ReadPairPool::put(std::vector<ReadPair*>* pairs) {
+  if (pthread_mutex_lock(&pool_access)!=0)
+	err(1,"ReadPairPool::put(): pthread_mutex_lock() failed");
+  free_pairs.insert(free_pairs.end(), pairs->begin(), pairs->end());
+  if (pthread_mutex_unlock(&pool_access)!=0)
+	err(1,"ReadPairPool::put(): pthread_mutex_unlock() failed");
+  pairs->clear();
+}
+
+MultithreadData::MultithreadData(int _slots, int _chunk_slots,
+                                 int _output_window)
+: chunks_to_parse(_chunk_slots),
+  items_to_process(_slots), items_to_output(_slots),
+  output_window(_output_window),
   input_count(0), output_count(0) {
   if (pthread_mutex_init(&counter_mutex, NULL)!=0)
 	err(1,"MTData::ctor(): pthread_mutex_init() failed");
 }
 
-void MultithreadData::increment_input_counter() {
+void MultithreadData::get_free_read_pairs(size_t num_pairs,
+                                          std::vector<ReadPair*>* pairs) {
+  read_pair_pool.get(num_pairs, pairs);
+}
+
+void MultithreadData::recycle_read_pairs(std::vector<ReadPair*>* pairs) {
+  read_pair_pool.put(pairs);
+}
+
+void MultithreadData::increment_input_counter(size_t num_reads) {
   if (pthread_mutex_lock(&counter_mutex)!=0)
 	err(1,"MTData::incr_input_cnt(): pthread_mutex_lock() failed");
-  input_count++;
+  input_count += num_reads;
   if (pthread_mutex_unlock(&counter_mutex)!=0)
 	err(1,"MTData::incr_input_cnt(): pthread_mutex_unlock() failed");
 }
 
-void MultithreadData::increment_output_counter() {
+void MultithreadData::increment_output_counter(size_t num_reads) {
   if (pthread_mutex_lock(&counter_mutex)!=0)
 	err(1,"MTData::incr_output_cnt(): pthread_mutex_lock() failed");
-  output_count++;
+  output_count += num_reads;
   if (pthread_mutex_unlock(&counter_mutex)!=0)
 	err(1,"MTData::incr_output_cnt(): pthread_mutex_unlock() failed");
 }
@@ -61,11 +108,19 @@ bool MultithreadData::input_output_counters_equal() {
   return equal;
 }
 
-void MultithreadData::post_new_input_read(ReadPair* pRecord) {
-  items_to_process.put(pRecord);
+void MultithreadData::post_new_chunk(TextChunk* pChunk) {
+  chunks_to_parse.put(pChunk);
+}
+
+TextChunk* MultithreadData::get_new_chunk() {
+  return chunks_to_parse.get();
+}
+
+void MultithreadData::post_new_input_batch(ReadPairBatch* pBatch) {
+  items_to_process.put(pBatch);
 }
 
-ReadPair* MultithreadData::get_new_input() {
+ReadPairBatch* MultithreadData::get_new_input() {
   return items_to_process.get();
 }
 
@@ -73,14 +128,22 @@ void MultithreadData::wait_for_completed_input_processing() {
   items_to_process.wait_for_all_slots();
 }
 
-void MultithreadData::post_new_output_read(ReadPair* pRecord) {
-  items_to_output.put(pRecord);
+void MultithreadData::post_new_output_batch(ReadPairBatch* pBatch) {
+  items_to_output.put(pBatch);
 }
 
-ReadPair* MultithreadData::get_new_output() {
+ReadPairBatch* MultithreadData::get_new_output() {
   return items_to_output.get();
 }
 
 void MultithreadData::wait_for_completed_output_processing() {
   items_to_output.wait_for_all_slots();
 }
+
+void MultithreadData::wait_for_output_window() {
+  output_window.wait();
+}
+
+void MultithreadData::release_output_window() {
+  output_window.post();
+}
@@ -24,48 +24,51 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <pthread.h>
 #include "xsemaphore.h"
 
-#include <list>
 #include <string>
+#include <vector>
 
 #include "src/ReadPair.h"
+#include "src/TextChunkReader.h"
 
+/*
+  Bounded ring buffer of items. Synchronization happens once per item,
+  so producers and consumers should exchange batches (see ReadPairBatch)
+  rather than single reads to keep the locking cost per read low.
+ */
 template<class ITEM>
-class ProtectedList {
+class ProtectedRing {
  private:
-  std::list <ITEM> items;
-  pthread_mutex_t list_access;
+  std::vector<ITEM> items;
+  size_t head;
+  size_t tail;
+  pthread_mutex_t ring_access;
   XSemaphore empty_slots;
   XSemaphore full_slots;
-  size_t num_items;
   int slots;
 
  public:
-  explicit ProtectedList(int _slots) :
+  explicit ProtectedRing(int _slots) :
+  items(_slots),
+  head(0),
+  tail(0),
   empty_slots(_slots),
   full_slots(0),
-  num_items(0),
     slots(_slots) {
-      if (pthread_mutex_init(&list_access, NULL)!=0)
-	err(1,"ProtectedList::ctor(): pthread_mutex_init() failed");
-
-      num_items = 0;
+      if (pthread_mutex_init(&ring_access, NULL)!=0)
+	err(1,"ProtectedRing::ctor(): pthread_mutex_init() failed");
     }
 
   void put(ITEM item) {
     empty_slots.wait();
 
-    // Lock the list access
-    if (pthread_mutex_lock(&list_access)!=0)
-	err(1,"ProtectedList::ctor(): pthread_mutex_lock() failed");
+    if (pthread_mutex_lock(&ring_access)!=0)
+	err(1,"ProtectedRing::put(): pthread_mutex_lock() failed");
 
-    // Add this record to the list
-    items.push_back(item);
+    items[tail] = item;
+    tail = (tail + 1) % items.size();
 
-    // Release the lock
-    if (pthread_mutex_unlock(&list_access)!=0)
-	err(1,"ProtectedList::ctor(): pthread_mutex_unlock() failed");
-
-    num_items++;
+    if (pthread_mutex_unlock(&ring_access)!=0)
+	err(1,"ProtectedRing::put(): pthread_mutex_unlock() failed");
 
     // Flag consumer threads
     full_slots.post();
@@ -75,24 +78,14 @@ class ProtectedList {
     // Wait for a semaphore to be avialble
     full_slots.wait();
 
-    // Lock the list access
-    if (pthread_mutex_lock(&list_access)!=0)
-	err(1,"ProtectedList::ctor(): pthread_mutex_lock() failed");
-
-    // Get an element from the list, and remove it
+    if (pthread_mutex_lock(&ring_access)!=0)
+	err(1,"ProtectedRing::get(): pthread_mutex_lock() failed");
 
-    // Should never happen...
-    if (items.empty())
-      errx(1, "Internal error: Multithreaded " \
-           "Protected list is empty (after getting a semaphore)");
+    ITEM item = items[head];
+    head = (head + 1) % items.size();
 
-    ITEM item = items.front();
-    items.pop_front();
-    num_items--;
-
-    // Release the lock
-    if (pthread_mutex_unlock(&list_access)!=0)
-	err(1,"ProtectedList::ctor(): pthread_mutex_unlock() failed");
+    if (pthread_mutex_unlock(&ring_access)!=0)
+	err(1,"ProtectedRing::get(): pthread_mutex_unlock() failed");
     empty_slots.post();
     return item;
   }
@@ -104,35 +97,76 @@ class ProtectedList {
   }
 };
 
+/*
+  Free list of ReadPair objects. Reads are handed back here instead of
+  being deleted, so their strings keep their memory and the readers
+  fill them in place rather than allocating for every record.
+ */
+class ReadPairPool {
+ private:
+  std::vector<ReadPair*> free_pairs;
+  pthread_mutex_t pool_access;
+
+ public:
+  ReadPairPool();
+  ~ReadPairPool();
+  // Append num_pairs objects to *pairs, allocating when the pool is empty
+  void get(size_t num_pairs, std::vector<ReadPair*>* pairs);
+  // Return all objects in *pairs to the pool and clear it
+  void put(std::vector<ReadPair*>* pairs);
+};
+
 class MultithreadData {
  private:
-  ProtectedList<ReadPair*> items_to_process;
-  ProtectedList<ReadPair*> items_to_output;
+  ProtectedRing<TextChunk*> chunks_to_parse;
+  ProtectedRing<ReadPairBatch*> items_to_process;
+  ProtectedRing<ReadPairBatch*> items_to_output;
+  ReadPairPool read_pair_pool;
+
+  // Bounds the number of batches between the reader and the
+  // output-writer thread (ordered output only)
+  XSemaphore output_window;
 
   pthread_mutex_t counter_mutex;
   size_t input_count;
   size_t output_count;
 
  public:
-  explicit MultithreadData(int _slots);
+  MultithreadData(int _slots, int _chunk_slots, int _output_window);
+
+  /* From the READER to the input parsing threads.
+     NULL is the 'poison pill' */
+  void post_new_chunk(TextChunk* pChunk);
+
+  /* Used in the input parsing threads */
+  TextChunk* get_new_chunk();
 
   /* From the READER(Producer) to the Satellite
-     processing threads (consumer) */
-  void post_new_input_read(ReadPair* pRecord);
+     processing threads (consumer). NULL is the 'poison pill' */
+  void post_new_input_batch(ReadPairBatch* pBatch);
 
   /* Used in the Satellite processing threads */
-  ReadPair* get_new_input();
+  ReadPairBatch* get_new_input();
 
   void wait_for_completed_input_processing();
 
   /* From the Satellite processing threads to the output-writer thread */
-  void post_new_output_read(ReadPair *pRecord);
+  void post_new_output_batch(ReadPairBatch* pBatch);
 
   /* Used in the Output-Writer thread */
-  ReadPair* get_new_output();
+  ReadPairBatch* get_new_output();
   void wait_for_completed_output_processing();
-  void increment_input_counter();
-  void increment_output_counter();
+
+  /* Ordered output: the reader takes a window slot for every batch it
+     hands out, the writer returns it once the batch is written */
+  void wait_for_output_window();
+  void release_output_window();
+  /* Reuse ReadPair objects across all threads */
+  void get_free_read_pairs(size_t num_pairs, std::vector<ReadPair*>* pairs);
+  void recycle_read_pairs(std::vector<ReadPair*>* pairs);
+
+  void increment_input_counter(size_t num_reads = 1);
+  void increment_output_counter(size_t num_reads = 1);
   bool input_output_counters_equal();
 };
 
@@ -63,4 +63,14 @@ class ReadPair {
   void ResetAlignmentFlags();
 };
 
+/*
+  A batch of consecutive reads handed between threads as a single
+  unit. Batches are numbered in input order so the output can be
+  written back in input order.
+*/
+struct ReadPairBatch {
+  size_t sequence;
+  std::vector<ReadPair*> reads;
+};
+
 #endif  // SRC_READPAIR_H_
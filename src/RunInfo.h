@@ -56,6 +56,10 @@ class RunInfo {
   int total_insert;
   int num_nonunit;
   size_t num_processed_units; // reads or pairs
+  size_t num_exact_flank_searches; // flanks allowed no differences
+  size_t num_gapped_flank_searches;
+  size_t num_verified_flanks; // --anchor-verify
+  size_t num_seeded_flanks; // --seeder minimizer
 
   // Allelotype stats
   std::vector<std::string> samples;
@@ -81,6 +85,10 @@ class RunInfo {
     total_insert = 0;
     num_nonunit = 0;
     num_processed_units = 0;
+    num_exact_flank_searches = 0;
+    num_gapped_flank_searches = 0;
+    num_verified_flanks = 0;
+    num_seeded_flanks = 0;
     samples.clear();
     num_calls.clear();
     num_calls5x.clear();
@@ -116,6 +124,10 @@ class RunInfo {
       } else {
 	ss << "No reads aligned" << std::endl;
       }
+      ss << "Flank searches\texact " << num_exact_flank_searches
+	 << "\tgapped " << num_gapped_flank_searches
+	 << "\tverified " << num_verified_flanks
+	 << "\tminimizer " << num_seeded_flanks << std::endl;
     } else {
       ss << "Allelotype stats" << std::endl;
       for (size_t i = 0; i < samples.size(); i++) {
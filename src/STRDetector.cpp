@@ -18,33 +18,89 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 */
 
+#include <pthread.h>
+#include <stdlib.h>
+
 #include <algorithm>
+#include <sstream>
 
+#include "src/AutocorrelationDetection.h"
 #include "src/common.h"
 #include "src/EntropyDetection.h"
 #include "src/runtime_parameters.h"
 #include "src/STRDetector.h"
+#include "src/STRPrescreen.h"
 
 using namespace std;
 
 const size_t EXTEND_FLANK = 6;
-const size_t MIN_REP_LENGTH[] = {8, 8, 8, 10, 10, 10};
+// --detector-check: STR locations closer than this count as the same
+const size_t DETECTOR_CHECK_MAX_SHIFT = 5;
+
+static pthread_mutex_t detector_check_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t num_detector_checked_reads = 0;
+static size_t num_entropy_found = 0;
+static size_t num_autocorrelation_found = 0;
+static size_t num_both_found = 0;
+static size_t num_same_location = 0;
+
+void RecordDetectorCheck(bool entropy_found, size_t entropy_start,
+                         size_t entropy_end, bool autocorrelation_found,
+                         size_t autocorrelation_start,
+                         size_t autocorrelation_end) {
+  pthread_mutex_lock(&detector_check_mutex);
+  num_detector_checked_reads++;
+  if (entropy_found) num_entropy_found++;
+  if (autocorrelation_found) num_autocorrelation_found++;
+  if (entropy_found && autocorrelation_found) {
+    num_both_found++;
+    if (abs(static_cast<int>(entropy_start - autocorrelation_start)) <=
+        static_cast<int>(DETECTOR_CHECK_MAX_SHIFT) &&
+        abs(static_cast<int>(entropy_end - autocorrelation_end)) <=
+        static_cast<int>(DETECTOR_CHECK_MAX_SHIFT)) {
+      num_same_location++;
+    }
+  }
+  pthread_mutex_unlock(&detector_check_mutex);
+}
+
+void PrintDetectorCheckSummary() {
+  stringstream msg;
+  msg << "Detector check: " << num_detector_checked_reads << " reads checked, "
+      << "STR found by the entropy detector in " << num_entropy_found
+      << ", by the autocorrelation detector in " << num_autocorrelation_found
+      << ", by both in " << num_both_found << ", " << num_same_location
+      << " of them with start and end within " << DETECTOR_CHECK_MAX_SHIFT
+      << "bp";
+  PrintMessageDieOnError(msg.str(), PROGRESS);
+}
 
 STRDetector::STRDetector() {}
 
 bool STRDetector::ProcessReadPair(ReadPair* read_pair, string* err, string* messages) {
-  *err = "Detection-errors-here:";
-  *messages = "Detection-notes-here:";
+  // err and messages only feed the --debug output
+  if (debug) {
+    *err = "Detection-errors-here:";
+    *messages = "Detection-notes-here:";
+  }
   read_pair->read1_passed_detection = false;
   read_pair->read2_passed_detection = false;
   if (ProcessRead(&read_pair->reads.at(0), err)) {
     read_pair->read1_passed_detection = true;
   }
+  if (prescreen_check) {
+    RecordPrescreenCheck(read_pair->reads.at(0).prescreen_failed,
+                         read_pair->read1_passed_detection);
+  }
   // Returns true if at least one read in the pair is detected
   if (read_pair->reads.at(0).paired) {
     if (ProcessRead(&read_pair->reads.at(1), err)) {
       read_pair->read2_passed_detection = true;
     }
+    if (prescreen_check) {
+      RecordPrescreenCheck(read_pair->reads.at(1).prescreen_failed,
+                           read_pair->read2_passed_detection);
+    }
     return (read_pair->read1_passed_detection ||
             read_pair->read2_passed_detection);
   } else {
@@ -52,23 +108,28 @@ bool STRDetector::ProcessReadPair(ReadPair* read_pair, string* err, string* mess
   }
 }
 
-bool STRDetector::ProcessRead(MSReadRecord* read, string* err) {
-  // Get the size of the read so we don't keep computing
-  size_t read_length = read->nucleotides.size();
-  // Preprocessing checks
-  if (read_length < (fft_window_size-1) ||
-      calculate_N_percentage(read->nucleotides) > percent_N_discard) {
+static bool CheckSTRRegionLocation(size_t nuc_start, size_t nuc_end,
+                                   size_t read_length, string* err) {
+  if (nuc_start >= read_length ||
+      nuc_start <= 0 ||
+      nuc_end-nuc_start + 1 <= 0 ||
+      nuc_start >= nuc_end ||
+      nuc_end-nuc_start+1 >= read_length ||
+      nuc_end >= read_length) {
     if (debug) {
-      *err += "failed-read-length-check";
+      *err += "failed-STR-region-location-sanity-check";
     }
     return false;
   }
+  return true;
+}
 
+bool STRDetector::FindSTRByEntropy(const MSReadRecord& read,
+                                   size_t* nuc_start, size_t* nuc_end,
+                                   string* err) {
+  size_t read_length = read.nucleotides.size();
   //  Step 1 - sliding window
-  size_t nuc_start;
-  size_t nuc_end;
-  string detected_microsatellite_nucleotides = "";
-  EntropyDetection ed_filter(read->nucleotides,
+  EntropyDetection ed_filter(read.nucleotides,
                              fft_window_size, fft_window_step);
   if (!ed_filter.EntropyIsAboveThreshold()) {
     if (debug) {
@@ -82,37 +143,87 @@ bool STRDetector::ProcessRead(MSReadRecord* read, string* err) {
   bool rep_end = false;
   ed_filter.FindStartEnd(&start, &end, &rep_end);
 
-  nuc_start = start * fft_window_step;
-  nuc_end = (end + 2) * fft_window_step;
+  *nuc_start = start * fft_window_step;
+  *nuc_end = (end + 2) * fft_window_step;
 
-  if (nuc_start >= read_length ||
-      nuc_start <= 0 ||
-      nuc_end-nuc_start + 1 <= 0 ||
-      nuc_start >= nuc_end ||
-      nuc_end-nuc_start+1 >= read_length ||
-      nuc_end >= read_length) {
+  if (!CheckSTRRegionLocation(*nuc_start, *nuc_end, read_length, err)) {
+    return false;
+  }
+
+  // Step 2 - Check if evidence of repeats
+  bool passed_repeat_check = CheckRepeatCounts(read.nucleotides);
+  if (!passed_repeat_check) {
     if (debug) {
-      *err += "failed-STR-region-location-sanity-check";
+      *err += "failed-repeat-check";
     }
     return false;
   }
+  return true;
+}
 
-  // Step 2 - Check if evidence of repeats
-  bool passed_repeat_check = false;
-  for (size_t i = 1; i <= 6; i++) {
-    std::string bestkmer;
-    if (CheckRepeatCount(read->nucleotides, i, MIN_REP_LENGTH[i-MIN_PERIOD], &bestkmer)) {
-      passed_repeat_check = true;
-      break;
+bool STRDetector::FindSTRByAutocorrelation(const MSReadRecord& read,
+                                           size_t* nuc_start, size_t* nuc_end,
+                                           string* err) {
+  DetectedRepeat repeat;
+  if (!DetectRepeatByAutocorrelation(read.nucleotides, &repeat)) {
+    if (debug) {
+      *err += "failed-autocorrelation-repeat-check";
     }
+    return false;
   }
-  if (!passed_repeat_check) {
+  *nuc_start = repeat.start;
+  *nuc_end = repeat.end;
+  return CheckSTRRegionLocation(*nuc_start, *nuc_end,
+                                read.nucleotides.size(), err);
+}
+
+bool STRDetector::ProcessRead(MSReadRecord* read, string* err) {
+  // The reader found this read can not pass and did not fill it in
+  if (read->prescreen_failed && !prescreen_check) {
     if (debug) {
-      *err += "failed-repeat-check";
+      *err += "failed-prescreen";
+    }
+    return false;
+  }
+  // Get the size of the read so we don't keep computing
+  size_t read_length = read->nucleotides.size();
+  // Preprocessing checks
+  if (read_length < (fft_window_size-1) ||
+      calculate_N_percentage(read->nucleotides) > percent_N_discard) {
+    if (debug) {
+      *err += "failed-read-length-check";
     }
     return false;
   }
 
+  size_t nuc_start = 0;
+  size_t nuc_end = 0;
+  bool found;
+  if (detector_engine == DETECTOR_AUTOCORRELATION) {
+    found = FindSTRByAutocorrelation(*read, &nuc_start, &nuc_end, err);
+  } else {
+    found = FindSTRByEntropy(*read, &nuc_start, &nuc_end, err);
+  }
+  if (detector_check) {
+    // Run the other detector as well, and compare
+    size_t other_start = 0;
+    size_t other_end = 0;
+    string other_err;
+    if (detector_engine == DETECTOR_AUTOCORRELATION) {
+      bool other_found = FindSTRByEntropy(*read, &other_start, &other_end,
+                                          &other_err);
+      RecordDetectorCheck(other_found, other_start, other_end,
+                          found, nuc_start, nuc_end);
+    } else {
+      bool other_found = FindSTRByAutocorrelation(*read, &other_start,
+                                                  &other_end, &other_err);
+      RecordDetectorCheck(found, nuc_start, nuc_end,
+                          other_found, other_start, other_end);
+    }
+  }
+  if (!found) {
+    return false;
+  }
   // Step 3 - Store values in the Read Record
   read->ms_start = nuc_start;
   read->ms_end   = nuc_end;
@@ -132,54 +243,51 @@ bool STRDetector::ProcessRead(MSReadRecord* read, string* err) {
   if ((EXTEND_FLANK <= nuc_start) &&
       (nuc_start-EXTEND_FLANK < read_length) &&
       (nuc_end + EXTEND_FLANK + 1 < read_length)) {
-    detected_microsatellite_nucleotides =
-      read->nucleotides.substr(nuc_start-EXTEND_FLANK,
-                               nuc_end - nuc_start+1+2*EXTEND_FLANK);
+    read->detected_ms_region_start = nuc_start - EXTEND_FLANK;
+    read->detected_ms_region_length = nuc_end - nuc_start + 1 +
+      2*EXTEND_FLANK;
   } else {
-    detected_microsatellite_nucleotides =
-      read->nucleotides.substr(nuc_start, nuc_end - nuc_start+1);
+    read->detected_ms_region_start = nuc_start;
+    read->detected_ms_region_length = nuc_end - nuc_start + 1;
   }
 
-  read->left_flank_nuc = (nuc_start>0) ?
-    read->nucleotides.substr(0, read->ms_start) : "-";
-  read->right_flank_nuc = read->nucleotides.substr(read->ms_end+1);
-  read->detected_ms_region_nuc = detected_microsatellite_nucleotides;
+  read->left_flank_length = read->ms_start;
+  read->right_flank_length = read_length - read->ms_end - 1;
 
   // adjust for max flank region lengths, if repetitive end, don't trim
   read->left_flank_index_from_start = 0;
   read->right_flank_index_from_end = 0;
-  if ((read->left_flank_nuc.size() > max_flank_len)) {
-    string left_flank = read->left_flank_nuc;
-    read->left_flank_nuc = left_flank.substr(left_flank.length()-
-                                             max_flank_len, max_flank_len);
-    read->left_flank_index_from_start = left_flank.length() -
+  if (read->left_flank_length > static_cast<int>(max_flank_len)) {
+    read->left_flank_index_from_start = read->left_flank_length -
       max_flank_len;
+    read->left_flank_length = max_flank_len;
   }
-  if ((read->right_flank_nuc.size() > max_flank_len)) {
-    string right_flank = read->right_flank_nuc;
-    read->right_flank_nuc = right_flank.substr(0, max_flank_len);
-    read->right_flank_index_from_end = right_flank.length() - max_flank_len;
+  if (read->right_flank_length > static_cast<int>(max_flank_len)) {
+    read->right_flank_index_from_end = read->right_flank_length -
+      max_flank_len;
+    read->right_flank_length = max_flank_len;
   }
 
   size_t nuc_len = (read->orig_nucleotides.length() -
                     read->right_flank_index_from_end -
                     read->left_flank_index_from_start);
 
+  // Trim the read to the flanks in place, the strings keep their memory
   if (((read->left_flank_index_from_start+nuc_len) <= read_length)) {
-    read->nucleotides = read->
-      orig_nucleotides.substr(read->left_flank_index_from_start, nuc_len);
-    read_length = read->nucleotides.size();
-    read->quality_scores = read->
-      quality_scores.substr(read->left_flank_index_from_start,
-                            read_length);
+    read->nucleotides.assign(read->orig_nucleotides,
+                             read->left_flank_index_from_start, nuc_len);
+    read->quality_scores.erase(0, read->left_flank_index_from_start);
+    if (read->quality_scores.size() > nuc_len) {
+      read->quality_scores.resize(nuc_len);
+    }
   } else {
     if (debug) {
       *err += "failed-after-trimming-flanking-regions;";
     }
     return false;
   }
-  if ( read->left_flank_nuc.length() < min_flank_len ||
-       read->right_flank_nuc.length() < min_flank_len) {
+  if (read->left_flank_length < static_cast<int>(min_flank_len) ||
+      read->right_flank_length < static_cast<int>(min_flank_len)) {
     if (debug) {
       *err += "failed-min-flank-len;";
     }
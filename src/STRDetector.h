@@ -21,6 +21,8 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef SRC_STRDETECTOR_H__
 #define SRC_STRDETECTOR_H__
 
+#include <string>
+
 #include "src/MSReadRecord.h"
 
 class STRDetector {
@@ -29,7 +31,25 @@ class STRDetector {
   bool ProcessReadPair(ReadPair* read_pair, std::string* err, std::string* messages);
  private:
   bool ProcessRead(MSReadRecord* read, std::string* err);
+  // Locate the STR in the read with the sliding window entropy and
+  // the kmer repeat check (--detector entropy)
+  bool FindSTRByEntropy(const MSReadRecord& read, size_t* nuc_start,
+                        size_t* nuc_end, std::string* err);
+  // Locate the STR in the read with DetectRepeatByAutocorrelation
+  // (--detector autocorrelation)
+  bool FindSTRByAutocorrelation(const MSReadRecord& read, size_t* nuc_start,
+                                size_t* nuc_end, std::string* err);
 };
 
+// --detector-check: record the STR locations found by both detectors
+// in a read. Thread safe
+void RecordDetectorCheck(bool entropy_found, size_t entropy_start,
+                         size_t entropy_end, bool autocorrelation_found,
+                         size_t autocorrelation_start,
+                         size_t autocorrelation_end);
+
+// --detector-check: report how often the two detectors agree
+void PrintDetectorCheckSummary();
+
 #endif  // SRC_STRDETECTOR_H__
 
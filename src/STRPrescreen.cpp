@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <sstream>
+#include <string>
+
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+#include "src/STRPrescreen.h"
+
+using namespace std;
+
+// Reads longer than this are passed on without screening
+const size_t PRESCREEN_MAX_LENGTH = 1024;
+const size_t PRESCREEN_MASK_WORDS = PRESCREEN_MAX_LENGTH/64;
+
+static pthread_mutex_t prescreen_check_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t num_checked_reads = 0;
+static size_t num_screened_out = 0;
+static size_t num_disagreements = 0;
+
+/*
+  Set bit j of mask when nucs[j] == nucs[j+period], for all
+  j < length-period. 16 positions are compared at a time with SSE2.
+ */
+static void PeriodMatchMask(const char* nucs, size_t length, size_t period,
+                            uint64_t* mask) {
+  for (size_t w = 0; w < PRESCREEN_MASK_WORDS; w++) {
+    mask[w] = 0;
+  }
+  size_t num_positions = length - period;
+  size_t j = 0;
+#ifdef __SSE2__
+  for (; j + 16 <= num_positions; j += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(nucs + j));
+    __m128i b = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(nucs + j + period));
+    uint64_t bits = static_cast<uint64_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+    // j is a multiple of 16, so the 16 bits never straddle two words
+    mask[j/64] |= bits << (j % 64);
+  }
+#endif
+  for (; j < num_positions; j++) {
+    if (nucs[j] == nucs[j + period]) {
+      mask[j/64] |= static_cast<uint64_t>(1) << (j % 64);
+    }
+  }
+}
+
+// Check for run_length consecutive bits set in the mask
+static bool HasRun(const uint64_t* mask, size_t num_words, size_t run_length) {
+  uint64_t runs[PRESCREEN_MASK_WORDS];
+  for (size_t w = 0; w < num_words; w++) {
+    runs[w] = mask[w];
+  }
+  // After step t, bit j is set if bits j..j+t are all set
+  for (size_t t = 1; t < run_length; t++) {
+    bool any = false;
+    for (size_t w = 0; w < num_words; w++) {
+      uint64_t next = (w + 1 < num_words) ? mask[w + 1] : 0;
+      uint64_t shifted = (mask[w] >> t) | (next << (64 - t));
+      runs[w] &= shifted;
+      any = any || (runs[w] != 0);
+    }
+    if (!any) return false;
+  }
+  for (size_t w = 0; w < num_words; w++) {
+    if (runs[w] != 0) return true;
+  }
+  return false;
+}
+
+bool PrescreenRead(const char* nucs, size_t length) {
+  // Same checks, in the same order, as STRDetector::ProcessRead
+  if (length < (fft_window_size-1) ||
+      calculate_N_percentage(nucs, length) > percent_N_discard) {
+    return false;
+  }
+  if (length > PRESCREEN_MAX_LENGTH) {
+    return true;
+  }
+  // CheckRepeatCount refuses reads shorter than the repeat length
+  // checked for, leave those to the detector
+  for (size_t period = 1; period <= 6; period++) {
+    if (length < MIN_REP_LENGTH[period-MIN_PERIOD]) {
+      return true;
+    }
+  }
+  // CheckRepeatCount(period) only passes if the read contains the most
+  // common kmer repeated to MIN_REP_LENGTH nucleotides. That stretch
+  // has MIN_REP_LENGTH-period consecutive positions matching the
+  // position one period further
+  uint64_t mask[PRESCREEN_MASK_WORDS];
+  size_t num_words = (length + 63)/64;
+  for (size_t period = 1; period <= 6; period++) {
+    PeriodMatchMask(nucs, length, period, mask);
+    if (HasRun(mask, num_words,
+               MIN_REP_LENGTH[period-MIN_PERIOD] - period)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RecordPrescreenCheck(bool screened_out, bool passed_detection) {
+  pthread_mutex_lock(&prescreen_check_mutex);
+  num_checked_reads++;
+  if (screened_out) {
+    num_screened_out++;
+    if (passed_detection) {
+      num_disagreements++;
+    }
+  }
+  pthread_mutex_unlock(&prescreen_check_mutex);
+}
+
+void PrintPrescreenCheckSummary() {
+  stringstream msg;
+  msg << "Pre-screen check: " << num_screened_out << " of "
+      << num_checked_reads << " reads screened out, "
+      << num_disagreements << " of them passed detection";
+  PrintMessageDieOnError(msg.str(), PROGRESS);
+  if (num_disagreements > 0) {
+    PrintMessageDieOnError("Pre-screen rejected reads that passed detection",
+                           WARNING);
+  }
+}
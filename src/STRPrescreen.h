@@ -0,0 +1,43 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_STRPRESCREEN_H__
+#define SRC_STRPRESCREEN_H__
+
+#include <stddef.h>
+
+/*
+  Cheap test on the raw sequence of a read, run by the readers before
+  the read is built. Returns false only for reads STRDetector is
+  certain to reject: reads that are too short, have too many Ns, or
+  have no stretch periodic with period 1-6 that is long enough to pass
+  CheckRepeatCount. nucs must already be quality trimmed.
+ */
+bool PrescreenRead(const char* nucs, size_t length);
+
+// --prescreen-check: record whether a read the pre-screen rejected
+// passed detection anyway. Thread safe
+void RecordPrescreenCheck(bool screened_out, bool passed_detection);
+
+// --prescreen-check: report the number of reads checked and any
+// disagreements with the detector
+void PrintPrescreenCheckSummary();
+
+#endif  // SRC_STRPRESCREEN_H__
@@ -0,0 +1,258 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <string.h>
+
+#include <string>
+
+#include "src/common.h"
+#include "src/FastaFileReader.h"
+#include "src/FastaPairedFileReader.h"
+#include "src/FastqFileReader.h"
+#include "src/FastqPairedFileReader.h"
+#include "src/runtime_parameters.h"
+#include "src/TextChunkReader.h"
+
+using namespace std;
+
+const size_t CHUNKER_BUFFER_SIZE = 4*1024*1024;
+
+RecordChunker::RecordChunker(const string& _filename, int _lines_per_record)
+  : filename(_filename),
+    input_file(NULL),
+    mapped_file(NULL),
+    lines_per_record(_lines_per_record),
+    base(NULL),
+    start(0), scan_pos(0), end(0),
+    record_lines(0), current_line(0), eof(false) {
+  bool from_stdin = (filename.empty() || is_stdin(filename));
+  if (use_mmap && !from_stdin) {
+    mapped_file = new MappedFile;
+    if (mapped_file->Open(filename)) {
+      // The whole file is in memory already
+      base = mapped_file->data();
+      end = mapped_file->size();
+      eof = true;
+      return;
+    }
+    // Not a regular file, read it as a stream
+    delete mapped_file;
+    mapped_file = NULL;
+  }
+  input_file = from_stdin ? stdin : fopen(filename.c_str(), "r");
+  if (input_file == NULL)
+    err(1, "Failed to open file '%s'", filename.c_str());
+  buffer.resize(CHUNKER_BUFFER_SIZE);
+  base = &buffer[0];
+}
+
+RecordChunker::~RecordChunker() {
+  if (input_file != NULL && input_file != stdin) {
+    fclose(input_file);
+  }
+  delete mapped_file;
+}
+
+bool RecordChunker::FillBuffer() {
+  if (eof) return false;
+  // Move the unconsumed data to the front of the buffer
+  if (start > 0) {
+    memmove(&buffer[0], &buffer[0] + start, end - start);
+    scan_pos -= start;
+    end -= start;
+    start = 0;
+  }
+  // A single record does not fit, make room for it
+  if (end == buffer.size()) {
+    buffer.resize(2*buffer.size());
+    base = &buffer[0];
+  }
+  size_t num_read = fread(&buffer[0] + end, 1, buffer.size() - end, input_file);
+  if (num_read == 0) {
+    if (ferror(input_file))
+      err(1, "Failed to read file '%s'", filename.c_str());
+    eof = true;
+    return false;
+  }
+  end += num_read;
+  return true;
+}
+
+size_t RecordChunker::GetRecords(size_t max_records, string* text,
+                                 const char** data, size_t* length) {
+  // Records of a mapped file are not copied, the chunk refers to them
+  const size_t first = start;
+  size_t num_records = 0;
+  size_t record_end = start;
+  while (num_records < max_records) {
+    const char* newline = NULL;
+    if (scan_pos < end) {
+      newline = static_cast<const char*>(memchr(base + scan_pos, '\n',
+                                                end - scan_pos));
+    }
+    if (newline != NULL) {
+      scan_pos = newline - base + 1;
+      if (++record_lines == lines_per_record) {
+        record_lines = 0;
+        num_records++;
+        current_line += lines_per_record;
+        record_end = scan_pos;
+      }
+      continue;
+    }
+    // No complete line left, hand over the complete records and refill
+    if (mapped_file == NULL) {
+      text->append(base + start, record_end - start);
+    }
+    start = record_end;
+    if (!FillBuffer()) {
+      // End of file. Whatever is left is passed on as a last record,
+      // the parser decides whether it is valid.
+      if (start < end) {
+        if (mapped_file == NULL) {
+          text->append(base + start, end - start);
+        }
+        num_records++;
+        start = scan_pos = end;
+        record_lines = 0;
+      }
+      record_end = start;
+      break;
+    }
+    record_end = start;
+  }
+  if (mapped_file == NULL) {
+    text->append(base + start, record_end - start);
+  }
+  start = record_end;
+  if (mapped_file != NULL) {
+    *data = base + first;
+    *length = start - first;
+  } else {
+    *data = text->data();
+    *length = text->size();
+  }
+  return num_records;
+}
+
+TextChunkReader::TextChunkReader(const string& _filename1,
+                                 const string& _filename2,
+                                 size_t _first_read_count)
+  : _chunker1(NULL), _chunker2(NULL),
+    next_read_count(_first_read_count), done(false) {
+  int lines_per_record = (input_type == INPUT_FASTQ) ? 4 : 2;
+  if (paired && interleaved) {
+    // Both mates of a pair are cut as one record
+    lines_per_record *= 2;
+  }
+  _chunker1 = new RecordChunker(_filename1, lines_per_record);
+  if (paired && !interleaved) {
+    _chunker2 = new RecordChunker(_filename2, lines_per_record);
+  }
+}
+
+TextChunkReader::~TextChunkReader() {
+  delete _chunker1;
+  delete _chunker2;
+}
+
+bool TextChunkReader::GetNextChunk(TextChunk* chunk, size_t max_records) {
+  if (done) return false;
+  chunk->first_read_count = next_read_count;
+  chunk->text[0].clear();
+  chunk->filename[0] = _chunker1->GetFilename();
+  chunk->first_line[0] = _chunker1->GetCurrentLine();
+  size_t num_records = _chunker1->GetRecords(max_records, &chunk->text[0],
+                                             &chunk->data[0],
+                                             &chunk->length[0]);
+  if (num_records < max_records) done = true;
+  if (num_records == 0) return false;
+  if (_chunker2 != NULL) {
+    // Take exactly as many records from the second file, so the
+    // pairs stay in sync. Like FastqPairedFileReader, stop as soon
+    // as one of the files runs out.
+    chunk->text[1].clear();
+    chunk->filename[1] = _chunker2->GetFilename();
+    chunk->first_line[1] = _chunker2->GetCurrentLine();
+    size_t num_records2 = _chunker2->GetRecords(num_records, &chunk->text[1],
+                                                &chunk->data[1],
+                                                &chunk->length[1]);
+    if (num_records2 < num_records) {
+      done = true;
+      num_records = num_records2;
+    }
+  }
+  chunk->num_records = num_records;
+  next_read_count += num_records;
+  return true;
+}
+
+static IFileReader* create_chunk_file_reader(const char* data, size_t length,
+                                             const string& filename,
+                                             size_t first_line) {
+  if (input_type == INPUT_FASTQ) {
+    return new FastqFileReader(data, length, filename, first_line);
+  } else {
+    return new FastaFileReader(data, length, filename, first_line);
+  }
+}
+
+void ParseTextChunk(const TextChunk& chunk, vector<ReadPair*>* free_pairs,
+                    vector<ReadPair*>* reads) {
+  IFileReader* pReader = create_chunk_file_reader(chunk.data[0],
+                                                  chunk.length[0],
+                                                  chunk.filename[0],
+                                                  chunk.first_line[0]);
+  if (paired && interleaved) {
+    if (input_type == INPUT_FASTQ) {
+      pReader = new FastqPairedFileReader(pReader);
+    } else {
+      pReader = new FastaPairedFileReader(pReader);
+    }
+  } else if (paired) {
+    IFileReader* pReader2 = create_chunk_file_reader(chunk.data[1],
+                                                     chunk.length[1],
+                                                     chunk.filename[1],
+                                                     chunk.first_line[1]);
+    if (input_type == INPUT_FASTQ) {
+      pReader = new FastqPairedFileReader(pReader, pReader2);
+    } else {
+      pReader = new FastaPairedFileReader(pReader, pReader2);
+    }
+  }
+  size_t read_count = chunk.first_read_count;
+  while (1) {
+    ReadPair* pRecord;
+    if (free_pairs->empty()) {
+      pRecord = new ReadPair;
+    } else {
+      pRecord = free_pairs->back();
+      free_pairs->pop_back();
+    }
+    if (!pReader->GetNextRecord(pRecord)) {
+      free_pairs->push_back(pRecord);
+      break;
+    }
+    pRecord->read_count = read_count++;
+    reads->push_back(pRecord);
+  }
+  delete pReader;
+}
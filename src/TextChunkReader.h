@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_TEXTCHUNKREADER_H__
+#define SRC_TEXTCHUNKREADER_H__
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "src/MappedFile.h"
+#include "src/ReadPair.h"
+
+/*
+  A TextChunk holds the raw text of a run of consecutive FASTA/FASTQ
+  records (one text per file of a pair), cut on record boundaries so
+  it can be parsed independently of the rest of the file.
+ */
+struct TextChunk {
+  std::string text[2];
+  // Start and length of the chunk's text per file. Points into text[],
+  // or straight into the input file when it is memory-mapped (--mmap)
+  const char* data[2];
+  size_t length[2];
+  std::string filename[2];
+  // Line number of the line preceding the chunk, per file
+  size_t first_line[2];
+  // read_count to assign to the first record of the chunk
+  size_t first_read_count;
+  // Number of records in the chunk
+  size_t num_records;
+  // Sequence number of the batch parsed from this chunk
+  size_t sequence;
+};
+
+/*
+  Splits a single-lined FASTA/FASTQ file into runs of whole records
+  without parsing them. Only looks for newlines, so it is much cheaper
+  than parsing and one thread can feed several parsers.
+ */
+class RecordChunker {
+ public:
+  RecordChunker(const std::string& _filename, int _lines_per_record);
+  ~RecordChunker();
+  // Get up to max_records records. Returns the number of records.
+  // *data and *length are set to their text, which is appended to
+  // *text unless the file is memory-mapped. A truncated record at the
+  // end of the file is passed through so the parser can report it.
+  size_t GetRecords(size_t max_records, std::string* text,
+                    const char** data, size_t* length);
+  size_t GetCurrentLine() const { return current_line; }
+  const std::string& GetFilename() const { return filename; }
+
+ private:
+  bool FillBuffer();
+
+  std::string filename;
+  FILE* input_file;
+  // Set instead of input_file when the file is memory-mapped
+  MappedFile* mapped_file;
+  int lines_per_record;
+  std::vector<char> buffer;
+  // Input data, either &buffer[0] or the mapped file
+  const char* base;
+  // base[start, end) holds unconsumed data, scanned up to scan_pos
+  size_t start;
+  size_t scan_pos;
+  size_t end;
+  // lines already seen of the record being scanned
+  int record_lines;
+  size_t current_line;
+  bool eof;
+};
+
+/*
+  Cuts one file, or both files of a pair, into TextChunks. Chunks of
+  paired files always hold the same number of records from each file,
+  chunks of an interleaved file (--interleaved) whole pairs.
+ */
+class TextChunkReader {
+ public:
+  TextChunkReader(const std::string& _filename1,
+                  const std::string& _filename2,
+                  size_t _first_read_count);
+  ~TextChunkReader();
+  // Returns false when there are no records left
+  bool GetNextChunk(TextChunk* chunk, size_t max_records);
+  // read_count of the next record to be read
+  size_t GetNextReadCount() const { return next_read_count; }
+
+ private:
+  RecordChunker* _chunker1;
+  RecordChunker* _chunker2;
+  size_t next_read_count;
+  bool done;
+};
+
+// Parse all records of a chunk into *reads. ReadPair objects are taken
+// from the back of *free_pairs, or allocated once it is empty
+void ParseTextChunk(const TextChunk& chunk, std::vector<ReadPair*>* free_pairs,
+                    std::vector<ReadPair*>* reads);
+
+#endif  // SRC_TEXTCHUNKREADER_H__
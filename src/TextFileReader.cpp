@@ -26,15 +26,27 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/common.h"
 #include "src/IFileReader.h"
+#include "src/runtime_parameters.h"
 #include "src/TextFileReader.h"
 
 using namespace std;
 
 TextFileReader::TextFileReader(const std::string& _filename)
   : current_line(0), filename(_filename),
-    input_file_stream(_filename.empty() ? NULL :
+    mapped_file(create_mapped_file(filename)),
+    input_file_stream((_filename.empty() || is_stdin(_filename) ||
+                       mapped_file != NULL) ? NULL :
                       create_file_stream(filename)),
-    input_stream(_filename.empty() ? cin : *input_file_stream ) {}
+    line_reader(mapped_file != NULL ?
+                BufferedLineReader(mapped_file->data(), mapped_file->size()) :
+                BufferedLineReader(input_file_stream == NULL ? &cin :
+                                   input_file_stream)) {}
+
+TextFileReader::TextFileReader(const char* data, size_t length,
+                               const std::string& _filename,
+                               size_t _first_line)
+  : current_line(_first_line), filename(_filename),
+    mapped_file(NULL), input_file_stream(NULL), line_reader(data, length) {}
 
 std::ifstream* TextFileReader::create_file_stream(const std::string
                                                   &filename) {
@@ -47,7 +59,23 @@ std::ifstream* TextFileReader::create_file_stream(const std::string
   return input_stream;
 }
 
+// Returns NULL unless --mmap is given and the file can be mapped.
+// Files that can not be mapped, like pipes, are read as a stream
+MappedFile* TextFileReader::create_mapped_file(const std::string& filename) {
+  if (!use_mmap || filename.empty() || is_stdin(filename)) return NULL;
+  MappedFile* mapped_file = new MappedFile;
+  if (!mapped_file->Open(filename)) {
+    delete mapped_file;
+    return NULL;
+  }
+  return mapped_file;
+}
+
 TextFileReader::~TextFileReader() {
+  if (mapped_file != NULL) {
+    delete mapped_file;
+    mapped_file = NULL;
+  }
   if (input_file_stream != NULL) {
     delete input_file_stream;
     input_file_stream = NULL;
@@ -56,8 +84,10 @@ TextFileReader::~TextFileReader() {
 
 bool TextFileReader::GetNextLine(string* line) {
   current_line++;
-  if (!getline(input_stream, *line))
+  LineView view;
+  if (line_reader.GetLines(1, &view) == 0)
     return false;
+  line->assign(view.data, view.length);
   return true;
 }
 
@@ -25,11 +25,18 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <fstream>
 #include <string>
 
+#include "src/BufferedLineReader.h"
 #include "src/IFileReader.h"
+#include "src/MappedFile.h"
 
 class TextFileReader : public IFileReader {
  public:
   explicit TextFileReader(const std::string& _filename="");
+  // Read from a block of memory, which must outlive the reader.
+  // _filename and _first_line are only used to report the position
+  // of malformed records
+  TextFileReader(const char* data, size_t length,
+                 const std::string& _filename, size_t _first_line);
   virtual ~TextFileReader();
   virtual bool GetNextRead(MSReadRecord* read);
   virtual bool GetNextRecord(ReadPair* read_pair);
@@ -38,9 +45,12 @@ class TextFileReader : public IFileReader {
  protected:
   size_t current_line;
   std::string filename;
+  // Set when the input is read through a memory mapping (--mmap)
+  MappedFile *mapped_file;
   std::ifstream *input_file_stream;
-  std::istream &input_stream;
+  BufferedLineReader line_reader;
   static std::ifstream* create_file_stream(const std::string& filename);
+  static MappedFile* create_mapped_file(const std::string& filename);
 };
 
 #endif  // SRC_TEXTFILEREADER_H__
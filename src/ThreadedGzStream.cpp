@@ -0,0 +1,337 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/api/BamAux.h"
+#include "src/api/BamConstants.h"
+#include "src/ThreadedGzStream.h"
+
+using BamTools::UnpackUnsignedInt;
+using BamTools::UnpackUnsignedShort;
+namespace Constants = BamTools::Constants;
+
+ThreadedGzStreamBuf::ThreadedGzStreamBuf()
+  : file(NULL),
+    empty_buffers(NUM_BUFFERS),
+    full_buffers(0),
+    read_buffer(-1),
+    next_read_buffer(0),
+    at_eof(false),
+    stop_thread(false) {
+  setg(NULL, NULL, NULL);
+}
+
+ThreadedGzStreamBuf::~ThreadedGzStreamBuf() {
+  close();
+}
+
+bool ThreadedGzStreamBuf::open(const char* filename) {
+  if (is_open()) return false;
+  // "-" is standard input
+  if (strcmp(filename, "-") == 0) {
+    file = gzdopen(dup(STDIN_FILENO), "rb");
+  } else {
+    file = gzopen(filename, "rb");
+  }
+  if (file == NULL) return false;
+  for (int i = 0; i < NUM_BUFFERS; i++) {
+    buffers[i].resize(BUFFER_SIZE);
+    buffer_length[i] = 0;
+  }
+  if (pthread_create(&thread, NULL, inflate_thread,
+                     reinterpret_cast<void*>(this)) != 0)
+    err(1, "ThreadedGzStreamBuf::open(): pthread_create() failed");
+  return true;
+}
+
+void ThreadedGzStreamBuf::close() {
+  if (!is_open()) return;
+  // Wake up the inflate thread in case it waits for a free buffer
+  stop_thread = true;
+  empty_buffers.post();
+  if (pthread_join(thread, NULL) != 0)
+    err(1, "ThreadedGzStreamBuf::close(): pthread_join() failed");
+  gzclose(file);
+  file = NULL;
+}
+
+void* ThreadedGzStreamBuf::inflate_thread(void* arg) {
+  reinterpret_cast<ThreadedGzStreamBuf*>(arg)->InflateLoop();
+  return NULL;
+}
+
+void ThreadedGzStreamBuf::InflateLoop() {
+  int current = 0;
+  while (1) {
+    empty_buffers.wait();
+    if (stop_thread) break;
+    int num = gzread(file, &buffers[current][0], BUFFER_SIZE);
+    // Like gzstream, a read error ends the input
+    buffer_length[current] = (num < 0) ? 0 : num;
+    full_buffers.post();
+    if (num <= 0) break;
+    current = (current + 1) % NUM_BUFFERS;
+  }
+}
+
+int ThreadedGzStreamBuf::underflow() {
+  if (gptr() && gptr() < egptr())
+    return *reinterpret_cast<unsigned char*>(gptr());
+  if (!is_open() || at_eof)
+    return EOF;
+  // Hand the buffer we are done with back to the inflate thread
+  if (read_buffer != -1) {
+    empty_buffers.post();
+    read_buffer = -1;
+  }
+  full_buffers.wait();
+  int num = buffer_length[next_read_buffer];
+  if (num == 0) {
+    at_eof = true;
+    setg(NULL, NULL, NULL);
+    return EOF;
+  }
+  read_buffer = next_read_buffer;
+  next_read_buffer = (next_read_buffer + 1) % NUM_BUFFERS;
+  char* data = &buffers[read_buffer][0];
+  setg(data, data, data + num);
+  return *reinterpret_cast<unsigned char*>(gptr());
+}
+
+BgzfStreamBuf::BgzfStreamBuf()
+  : file(NULL),
+    next_block(0),
+    read_block(0),
+    reading(false),
+    at_eof(false),
+    end_of_file(false),
+    stop_threads(false) {
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  setg(NULL, NULL, NULL);
+}
+
+BgzfStreamBuf::~BgzfStreamBuf() {
+  close();
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+bool BgzfStreamBuf::IsBgzfFile(const char* filename) {
+  // Only regular files are sniffed, the header read from a pipe
+  // would be lost. zlib inflates BGZF from a pipe as plain gzip
+  struct stat st;
+  if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL) return false;
+  char header[Constants::BGZF_BLOCK_HEADER_LENGTH];
+  size_t num = fread(header, 1, Constants::BGZF_BLOCK_HEADER_LENGTH, f);
+  fclose(f);
+  return (num == Constants::BGZF_BLOCK_HEADER_LENGTH &&
+          header[0] == Constants::GZIP_ID1 &&
+          header[1] == Constants::GZIP_ID2 &&
+          header[2] == Constants::CM_DEFLATE &&
+          (header[3] & Constants::FLG_FEXTRA) != 0 &&
+          UnpackUnsignedShort(&header[10]) == Constants::BGZF_XLEN &&
+          header[12] == Constants::BGZF_ID1 &&
+          header[13] == Constants::BGZF_ID2 &&
+          UnpackUnsignedShort(&header[14]) == Constants::BGZF_LEN);
+}
+
+bool BgzfStreamBuf::open(const char* filename, int num_threads) {
+  if (is_open()) return false;
+  file = fopen(filename, "rb");
+  if (file == NULL) return false;
+  if (num_threads < 1) num_threads = 1;
+  blocks.resize(num_threads * BLOCKS_PER_THREAD);
+  for (size_t i = 0; i < blocks.size(); i++) {
+    blocks[i].data.resize(Constants::BGZF_MAX_BLOCK_SIZE);
+    blocks[i].length = 0;
+    blocks[i].state = BLOCK_EMPTY;
+  }
+  threads.resize(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    if (pthread_create(&threads[i], NULL, inflate_thread,
+                       reinterpret_cast<void*>(this)) != 0)
+      err(1, "BgzfStreamBuf::open(): pthread_create() failed");
+  }
+  return true;
+}
+
+void BgzfStreamBuf::close() {
+  if (!is_open()) return;
+  pthread_mutex_lock(&mutex);
+  stop_threads = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+  for (size_t i = 0; i < threads.size(); i++) {
+    if (pthread_join(threads[i], NULL) != 0)
+      err(1, "BgzfStreamBuf::close(): pthread_join() failed");
+  }
+  threads.clear();
+  fclose(file);
+  file = NULL;
+}
+
+void* BgzfStreamBuf::inflate_thread(void* arg) {
+  reinterpret_cast<BgzfStreamBuf*>(arg)->InflateLoop();
+  return NULL;
+}
+
+void BgzfStreamBuf::InflateLoop() {
+  z_stream zs;
+  zs.zalloc = NULL;
+  zs.zfree = NULL;
+  zs.opaque = NULL;
+  zs.next_in = NULL;
+  zs.avail_in = 0;
+  if (inflateInit2(&zs, Constants::GZIP_WINDOW_BITS) != Z_OK)
+    errx(1, "BgzfStreamBuf: zlib inflateInit failed");
+  while (1) {
+    // Reading from the file is serialized, inflating is not
+    pthread_mutex_lock(&mutex);
+    while (!stop_threads && !end_of_file &&
+           blocks[next_block % blocks.size()].state != BLOCK_EMPTY)
+      pthread_cond_wait(&cond, &mutex);
+    if (stop_threads || end_of_file) {
+      pthread_mutex_unlock(&mutex);
+      break;
+    }
+    Block* block = &blocks[next_block % blocks.size()];
+    next_block++;
+    if (!ReadBlock(block)) {
+      end_of_file = true;
+      block->state = BLOCK_END;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      break;
+    }
+    block->state = BLOCK_INFLATING;
+    pthread_mutex_unlock(&mutex);
+
+    InflateBlock(block, &zs);
+
+    pthread_mutex_lock(&mutex);
+    block->state = BLOCK_FULL;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+  }
+  inflateEnd(&zs);
+}
+
+bool BgzfStreamBuf::ReadBlock(Block* block) {
+  const size_t header_length = Constants::BGZF_BLOCK_HEADER_LENGTH;
+  char header[Constants::BGZF_BLOCK_HEADER_LENGTH];
+  size_t num = fread(header, 1, header_length, file);
+  if (num == 0) return false;
+  if (num != header_length ||
+      header[0] != Constants::GZIP_ID1 ||
+      header[1] != Constants::GZIP_ID2 ||
+      (header[3] & Constants::FLG_FEXTRA) == 0 ||
+      header[12] != Constants::BGZF_ID1 ||
+      header[13] != Constants::BGZF_ID2)
+    errx(1, "BgzfStreamBuf: invalid BGZF block header");
+  const size_t block_length = UnpackUnsignedShort(&header[16]) + 1;
+  if (block_length < header_length + Constants::BGZF_BLOCK_FOOTER_LENGTH)
+    errx(1, "BgzfStreamBuf: invalid BGZF block size");
+  block->compressed.resize(block_length);
+  memcpy(&block->compressed[0], header, header_length);
+  const size_t remaining = block_length - header_length;
+  if (fread(&block->compressed[header_length], 1, remaining, file)
+      != remaining)
+    errx(1, "BgzfStreamBuf: truncated BGZF block");
+  return true;
+}
+
+void BgzfStreamBuf::InflateBlock(Block* block, z_stream* zs) {
+  const size_t block_length = block->compressed.size();
+  const char* footer = &block->compressed[block_length -
+                                          Constants::BGZF_BLOCK_FOOTER_LENGTH];
+  if (inflateReset(zs) != Z_OK)
+    errx(1, "BgzfStreamBuf: zlib inflateReset failed");
+  zs->next_in = reinterpret_cast<Bytef*>(
+      &block->compressed[Constants::BGZF_BLOCK_HEADER_LENGTH]);
+  zs->avail_in = block_length - Constants::BGZF_BLOCK_HEADER_LENGTH
+    - Constants::BGZF_BLOCK_FOOTER_LENGTH;
+  zs->next_out = reinterpret_cast<Bytef*>(&block->data[0]);
+  zs->avail_out = block->data.size();
+  if (inflate(zs, Z_FINISH) != Z_STREAM_END)
+    errx(1, "BgzfStreamBuf: zlib inflate failed");
+  block->length = zs->total_out;
+  // Footer holds the CRC32 and the size of the uncompressed data
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(&block->data[0]),
+                    block->length);
+  if (UnpackUnsignedInt(footer + 4) != block->length ||
+      UnpackUnsignedInt(footer) != crc)
+    errx(1, "BgzfStreamBuf: BGZF block failed CRC check");
+}
+
+int BgzfStreamBuf::underflow() {
+  if (gptr() && gptr() < egptr())
+    return *reinterpret_cast<unsigned char*>(gptr());
+  if (!is_open() || at_eof)
+    return EOF;
+  pthread_mutex_lock(&mutex);
+  while (1) {
+    // Hand the block we are done with back to the inflate threads
+    if (reading) {
+      blocks[read_block % blocks.size()].state = BLOCK_EMPTY;
+      pthread_cond_broadcast(&cond);
+      read_block++;
+      reading = false;
+    }
+    Block* block = &blocks[read_block % blocks.size()];
+    while (block->state != BLOCK_FULL && block->state != BLOCK_END)
+      pthread_cond_wait(&cond, &mutex);
+    if (block->state == BLOCK_END) {
+      pthread_mutex_unlock(&mutex);
+      at_eof = true;
+      setg(NULL, NULL, NULL);
+      return EOF;
+    }
+    reading = true;
+    // Skip empty blocks, such as the BGZF end-of-file marker
+    if (block->length == 0) continue;
+    pthread_mutex_unlock(&mutex);
+    char* data = &block->data[0];
+    setg(data, data, data + block->length);
+    return *reinterpret_cast<unsigned char*>(gptr());
+  }
+}
+
+GzInputStream::GzInputStream(const char* filename, int num_threads)
+  : std::istream(NULL) {
+  bool opened;
+  if (BgzfStreamBuf::IsBgzfFile(filename)) {
+    rdbuf(&bgzf_buffer);
+    opened = bgzf_buffer.open(filename, num_threads);
+  } else {
+    rdbuf(&buffer);
+    opened = buffer.open(filename);
+  }
+  if (!opened) {
+    setstate(std::ios::failbit);
+  }
+}
@@ -0,0 +1,141 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_THREADEDGZSTREAM_H__
+#define SRC_THREADEDGZSTREAM_H__
+
+#include <pthread.h>
+#include <stdio.h>
+#include <zlib.h>
+
+#include <istream>
+#include <streambuf>
+#include <vector>
+
+#include "src/xsemaphore.h"
+
+/*
+  streambuf reading a gzipped file. Decompression runs on a background
+  thread that fills one buffer while the reader consumes the other, so
+  inflating overlaps with parsing.
+ */
+class ThreadedGzStreamBuf : public std::streambuf {
+ public:
+  ThreadedGzStreamBuf();
+  ~ThreadedGzStreamBuf();
+  bool open(const char* filename);
+  void close();
+  bool is_open() const { return file != NULL; }
+
+ protected:
+  virtual int underflow();
+
+ private:
+  static const int NUM_BUFFERS = 2;
+  static const size_t BUFFER_SIZE = 1024*1024;
+
+  static void* inflate_thread(void* arg);
+  void InflateLoop();
+
+  gzFile file;
+  std::vector<char> buffers[NUM_BUFFERS];
+  // Number of bytes inflated into each buffer. 0 at end of file
+  int buffer_length[NUM_BUFFERS];
+  XSemaphore empty_buffers;
+  XSemaphore full_buffers;
+  // Buffer currently read from, -1 if none
+  int read_buffer;
+  int next_read_buffer;
+  bool at_eof;
+  bool stop_thread;
+  pthread_t thread;
+};
+
+/*
+  streambuf reading a BGZF (bgzip) compressed file. BGZF blocks are
+  independent deflate streams, so a pool of threads reads and inflates
+  consecutive blocks concurrently. Inflated blocks are handed to the
+  reader strictly in file order.
+ */
+class BgzfStreamBuf : public std::streambuf {
+ public:
+  BgzfStreamBuf();
+  ~BgzfStreamBuf();
+  bool open(const char* filename, int num_threads);
+  void close();
+  bool is_open() const { return file != NULL; }
+
+  // Check whether the file starts with a BGZF block header
+  static bool IsBgzfFile(const char* filename);
+
+ protected:
+  virtual int underflow();
+
+ private:
+  enum BlockState {
+    BLOCK_EMPTY,     // free for the next block of the file
+    BLOCK_INFLATING, // read from the file, being inflated
+    BLOCK_FULL,      // inflated, waiting for the reader
+    BLOCK_END        // end of file reached
+  };
+  struct Block {
+    std::vector<char> compressed;
+    std::vector<char> data;
+    size_t length;
+    BlockState state;
+  };
+  // Blocks in flight per inflate thread
+  static const int BLOCKS_PER_THREAD = 4;
+
+  static void* inflate_thread(void* arg);
+  void InflateLoop();
+  bool ReadBlock(Block* block);
+  void InflateBlock(Block* block, z_stream* zs);
+
+  FILE* file;
+  std::vector<Block> blocks;
+  std::vector<pthread_t> threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  // Index of the next block read from the file
+  size_t next_block;
+  // Index of the block currently read from
+  size_t read_block;
+  bool reading;
+  bool at_eof;
+  bool end_of_file;
+  bool stop_threads;
+};
+
+/*
+  istream over a gzipped file. BGZF files are inflated block-parallel
+  on num_threads threads, plain gzip files on a single background thread.
+ */
+class GzInputStream : public std::istream {
+ public:
+  GzInputStream(const char* filename, int num_threads = 1);
+  ~GzInputStream() {}
+
+ private:
+  ThreadedGzStreamBuf buffer;
+  BgzfStreamBuf bgzf_buffer;
+};
+
+#endif  // SRC_THREADEDGZSTREAM_H__
@@ -30,6 +30,14 @@ class ZippedFastaFileReader : public ZippedTextFileReader {
   explicit ZippedFastaFileReader(const std::string& _filename="");
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
+  virtual void FillPrescreenedRead(MSReadRecord* read);
+
+ private:
+  // Fill read from the lines of the current record
+  void FillRead(MSReadRecord* read);
+  // Lines of the current record, pointing into the input buffer
+  LineView id_line;
+  LineView nuc_line;
 };
 
 #endif  // SRC_ZIPPEDFASTAFILEREADER_H__
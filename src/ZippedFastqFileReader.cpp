@@ -24,6 +24,7 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/common.h"
 #include "src/runtime_parameters.h"
+#include "src/STRPrescreen.h"
 #include "src/ZippedFastqFileReader.h"
 
 using namespace std;
@@ -32,35 +33,33 @@ ZippedFastqFileReader::ZippedFastqFileReader(const std::string& _filename)
   : ZippedTextFileReader(_filename) {}
 
 bool ZippedFastqFileReader::GetNextRecord(ReadPair* read_pair) {
-  read_pair->reads.clear();
-  MSReadRecord single_read;
-  if (GetNextRead(&single_read)) {
-    read_pair->reads.push_back(single_read);
-    return true;
-  } else {
-    return false;
-  }
+  // Fill the first read in place, so its strings keep their memory
+  read_pair->reads.resize(1);
+  return GetNextRead(&read_pair->reads[0]);
 }
 
 bool ZippedFastqFileReader::GetNextRead(MSReadRecord* read) {
-  string ID;
-  string nuc;
-  string ID2;
-  string quality;
+  // Lines of the record point into the input buffer. Only the parts
+  // we keep are copied into the read
+  LineView lines[4];
+  size_t num_lines = line_reader.GetLines(4, lines);
+  id_line = lines[0];
+  nuc_line = lines[1];
+  qual_line = lines[3];
 
   // First line = ID
   // If no more lines, this is EOF
   current_line++;
-  if (!getline(input_stream, ID))
+  if (num_lines == 0)
     return false;
 
   // Minimal input validation
-  if (ID.empty()) {
+  if (id_line.length == 0) {
     stringstream msg;
     msg << "Found empty ID in FASTQ file " << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  if (ID.at(0) != '@') {
+  if (id_line.data[0] != '@') {
     stringstream msg;
     msg << "Found Invalid FASTQ ID in file "
         << filename << " line " << current_line
@@ -72,20 +71,20 @@ bool ZippedFastqFileReader::GetNextRead(MSReadRecord* read) {
   // If we can read the ID, but not the nucleotides,
   // This is a problematic FASTQ file
   current_line++;
-  if (!getline(input_stream, nuc)) {
+  if (num_lines < 2) {
     stringstream msg;
     msg << "Problem reading nucleotide line from FASTQ file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
 
-  if (nuc.empty()) {
+  if (nuc_line.length == 0) {
     stringstream msg;
     msg << "Found empty nucleotide line from FASTQ file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  if (!valid_nucleotides_string(nuc)) {
+  if (!valid_nucleotides_string(nuc_line.data, nuc_line.length)) {
     stringstream msg;
     msg << "Found invalid nucleotide line from FASTQ file "
         << filename << " line " << current_line;
@@ -93,7 +92,7 @@ bool ZippedFastqFileReader::GetNextRead(MSReadRecord* read) {
   }
   // Third line = Second ID (ignored)
   current_line++;
-  if (!getline(input_stream, ID2)) {
+  if (num_lines < 3) {
     stringstream msg;
     msg << "Problem reading second ID line from FASTQ file "
         << filename << " line " << current_line;
@@ -102,27 +101,49 @@ bool ZippedFastqFileReader::GetNextRead(MSReadRecord* read) {
 
   // Fourth line = Quality scores (must be ASCII quality scores, not numeric)
   current_line++;
-  if (!getline(input_stream, quality)) {
+  if (num_lines < 4) {
     stringstream msg;
     msg << "Problem reading quality scores line from FASTQ file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
 
-  if (quality.length() != nuc.length()) {
+  if (qual_line.length != nuc_line.length) {
     stringstream msg;
     msg << "Mismatching number of nucleotides and quality scores in FASTQ file "
         << filename << " line " << current_line;
     PrintMessageDieOnError(msg.str(), ERROR);
   }
-  read->ID = ID.substr(1);
-  string trim_nucs;
-  string trim_qual;
-  TrimRead(nuc, quality, &trim_nucs, &trim_qual, QUAL_CUTOFF);
-  read->nucleotides = trim_nucs;
-  read->quality_scores = trim_qual;
-  read->orig_nucleotides = trim_nucs;
-  read->orig_qual = trim_qual;
-  read->paired = false;
+
+  trimmed_length = TrimmedReadLength(qual_line.data, qual_line.length,
+                                     QUAL_CUTOFF);
+  // Reads that can not pass detection are not filled in
+  bool screened_out = (prescreen_reads &&
+                       !PrescreenRead(nuc_line.data, trimmed_length));
+  if (screened_out && !prescreen_check) {
+    read->Reset();
+    read->prescreen_failed = true;
+    return true;
+  }
+  FillRead(read);
+  read->prescreen_failed = screened_out;
   return true;
 }
+
+void ZippedFastqFileReader::FillPrescreenedRead(MSReadRecord* read) {
+  // With prescreen_check, GetNextRead filled in the read already
+  if (read->prescreen_failed && !prescreen_check) {
+    FillRead(read);
+    read->prescreen_failed = true;
+  }
+}
+
+void ZippedFastqFileReader::FillRead(MSReadRecord* read) {
+  read->Reset();
+  read->ID.assign(id_line.data + 1, id_line.length - 1);
+  read->nucleotides.assign(nuc_line.data, trimmed_length);
+  read->quality_scores.assign(qual_line.data, trimmed_length);
+  read->orig_nucleotides = read->nucleotides;
+  read->orig_qual = read->quality_scores;
+  read->paired = false;
+}
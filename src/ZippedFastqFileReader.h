@@ -30,6 +30,17 @@ class ZippedFastqFileReader : public ZippedTextFileReader {
   explicit ZippedFastqFileReader(const std::string& _filename="");
   virtual bool GetNextRecord(ReadPair* read_pair);
   virtual bool GetNextRead(MSReadRecord* read);
+  virtual void FillPrescreenedRead(MSReadRecord* read);
+
+ private:
+  // Fill read from the lines of the current record
+  void FillRead(MSReadRecord* read);
+  // Lines of the current record, pointing into the input buffer
+  LineView id_line;
+  LineView nuc_line;
+  LineView qual_line;
+  // Length of the record after quality trimming
+  size_t trimmed_length;
 };
 
 #endif  // SRC_ZIPPEDFASTQFILEREADER_H__
@@ -24,6 +24,7 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/common.h"
 #include "src/IFileReader.h"
+#include "src/runtime_parameters.h"
 #include "src/ZippedTextFileReader.h"
 
 using namespace std;
@@ -31,12 +32,13 @@ using namespace std;
 ZippedTextFileReader::ZippedTextFileReader(const std::string& _filename)
   : current_line(0), filename(_filename),
     input_file_stream(_filename.empty() ? NULL : create_file_stream(filename)),
-  input_stream(_filename.empty() ? cin : *input_file_stream ) {}
+    line_reader(_filename.empty() ? &cin : input_file_stream) {}
 
-igzstream* ZippedTextFileReader::create_file_stream(const std::string&
-                                                    filename) {
-  igzstream *input_stream = new igzstream(filename.c_str(),
-                                          std::ios_base::in);
+GzInputStream* ZippedTextFileReader::create_file_stream(const std::string&
+                                                        filename) {
+  // BGZF input is inflated on as many threads as there are workers
+  GzInputStream *input_stream = new GzInputStream(filename.c_str(),
+                                                  static_cast<int>(threads));
   if (input_stream == NULL)
     err(1, "Failed to allocate memory for ifstream");
   if (!(*input_stream))
@@ -53,8 +55,10 @@ ZippedTextFileReader::~ZippedTextFileReader() {
 
 bool ZippedTextFileReader::GetNextLine(string* line) {
   current_line++;
-  if (!getline(input_stream, *line))
+  LineView view;
+  if (line_reader.GetLines(1, &view) == 0)
     return false;
+  line->assign(view.data, view.length);
   return true;
 }
 
@@ -23,8 +23,9 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <string>
 
-#include "src/gzstream.h"
+#include "src/BufferedLineReader.h"
 #include "src/IFileReader.h"
+#include "src/ThreadedGzStream.h"
 
 class ZippedTextFileReader : public IFileReader {
  public:
@@ -37,9 +38,9 @@ class ZippedTextFileReader : public IFileReader {
  protected:
   size_t current_line;
   std::string filename;
-  igzstream *input_file_stream;
-  std::istream &input_stream;
-  static igzstream* create_file_stream(const std::string& filename);
+  GzInputStream *input_file_stream;
+  BufferedLineReader line_reader;
+  static GzInputStream* create_file_stream(const std::string& filename);
 };
 
 #endif  // SRC_ZIPPEDTEXTFILEREADER_H__
@@ -62,6 +62,19 @@ typedef struct {
 
 #define bwt_occ_intv(b, k) ((b)->bwt + (k)/OCC_INTERVAL*12)
 
+// prefetch the occurrence block bwt_occ(b, k, c) reads; the block spans two cache lines
+#ifdef __GNUC__
+#define bwt_prefetch_occ(b, k) do {										\
+		bwtint_t _k = (k);												\
+		if (_k != (bwtint_t)(-1)) {										\
+			const uint32_t *_p = bwt_occ_intv(b, _k >= (b)->primary? _k - 1 : _k); \
+			__builtin_prefetch(_p); __builtin_prefetch(_p + 11);		\
+		}																\
+	} while (0)
+#else
+#define bwt_prefetch_occ(b, k)
+#endif
+
 // inverse Psi function
 #define bwt_invPsi(bwt, k)												\
 	(((k) == (bwt)->primary)? 0 :										\
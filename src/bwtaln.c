@@ -138,6 +138,109 @@ void bwa_cal_sa_reg_gap(int tid, bwt_t *const bwt[2], int n_seqs, bwa_seq_t *seq
 	gap_destroy_stack(stack);
 }
 
+/* bwt_cal_width() for n searches at once. Each step first prefetches the occurrence blocks of all
+   unfinished searches and then advances them, so that their cache misses overlap */
+static void bwt_cal_width_batch(int n, bwt_width_query_t *q)
+{
+	int j, n_active = 0;
+	for (j = 0; j != n; ++j) {
+		bwt_width_query_t *p = q + j;
+		p->i = p->bid = 0;
+		p->k = 0; p->l = p->bwt->seq_len;
+		if (p->len > 0) ++n_active;
+		else {
+			p->width[0].w = 0;
+			p->width[0].bid = 1;
+		}
+	}
+	while (n_active) {
+		for (j = 0; j != n; ++j) {
+			const bwt_width_query_t *p = q + j;
+			if (p->i < p->len && p->str[p->i] < 4) {
+				bwt_prefetch_occ(p->bwt, p->k - 1);
+				bwt_prefetch_occ(p->bwt, p->l);
+			}
+		}
+		for (j = 0; j != n; ++j) {
+			bwt_width_query_t *p = q + j;
+			ubyte_t c;
+			if (p->i == p->len) continue;
+			c = p->str[p->i];
+			if (c < 4) {
+				bwtint_t ok, ol;
+				bwt_2occ(p->bwt, p->k - 1, p->l, c, &ok, &ol);
+				p->k = p->bwt->L2[c] + ok + 1;
+				p->l = p->bwt->L2[c] + ol;
+			}
+			if (p->k > p->l || c > 3) { // then restart
+				p->k = 0;
+				p->l = p->bwt->seq_len;
+				++p->bid;
+			}
+			p->width[p->i].w = p->l - p->k + 1;
+			p->width[p->i].bid = p->bid;
+			if (++p->i == p->len) {
+				p->width[p->len].w = 0;
+				p->width[p->len].bid = ++p->bid;
+				--n_active;
+			}
+		}
+	}
+}
+
+int bwa_cal_sa_reg_gap_ws(gap_workspace_t *ws, bwt_t *const bwt[2], int n_seqs, bwa_seq_t *seqs, const gap_opt_t *opts)
+{
+	int i, a, n_queries = 0, max_len = 0, max_seed_len = 0, n_exact = 0;
+	for (i = 0; i != n_seqs; ++i) {
+		if (seqs[i].len > max_len) max_len = seqs[i].len;
+		if (opts[i].seed_len < seqs[i].len && opts[i].seed_len > max_seed_len) max_seed_len = opts[i].seed_len;
+	}
+	gap_reserve_widths(ws, n_seqs, max_len, max_seed_len);
+	// widths of both strands of every read, and of their seeds
+	for (i = 0; i != n_seqs; ++i) {
+		const bwa_seq_t *p = seqs + i;
+		const ubyte_t *seq[2];
+		seq[0] = p->seq; seq[1] = p->rseq;
+		for (a = 0; a != 2; ++a) {
+			bwt_width_query_t *q = ws->queries + n_queries++;
+			q->bwt = bwt[a]; q->str = seq[a]; q->len = p->len;
+			q->width = ws->w[a] + i * ws->m_w;
+			if (p->len > opts[i].seed_len && (opts[i].fnr > 0.0 || opts[i].max_diff != 0)) { // seeds of gapped searches
+				q = ws->queries + n_queries++;
+				q->bwt = bwt[a]; q->str = seq[a] + (p->len - opts[i].seed_len); q->len = opts[i].seed_len;
+				q->width = ws->seed_w[a] + i * ws->m_seed_w;
+			}
+		}
+	}
+	bwt_cal_width_batch(n_queries, ws->queries);
+	for (i = 0; i != n_seqs; ++i) {
+		bwa_seq_t *p = seqs + i;
+		const gap_opt_t *opt = opts + i;
+		gap_opt_t local_opt = *opt;
+		const ubyte_t *seq[2];
+		bwt_width_t *w[2], *seed_w[2];
+		if (opt->fnr > 0.0) local_opt.max_diff = bwa_cal_maxdiff(p->len, BWA_AVG_ERR, opt->fnr);
+		p->sa = 0; p->type = BWA_TYPE_NO_MATCH; p->c1 = p->c2 = 0; p->n_aln = 0;
+		seq[0] = p->seq; seq[1] = p->rseq;
+		for (a = 0; a != 2; ++a) {
+			w[a] = ws->w[a] + i * ws->m_w;
+			seed_w[a] = ws->seed_w[a] + i * ws->m_seed_w;
+		}
+		if (local_opt.max_diff == 0) { // the gapped search could only find exact hits
+			p->aln = bwt_match_exact_buf(bwt, p->len, seq, w, &local_opt, &p->n_aln, p->aln, &p->m_aln);
+			++n_exact;
+			continue;
+		}
+		if (local_opt.max_diff < local_opt.max_gapo) local_opt.max_gapo = local_opt.max_diff;
+		gap_reserve_stack(ws, local_opt.max_diff, local_opt.max_gapo, local_opt.max_gape, &local_opt);
+		local_opt.seed_len = opt->seed_len < p->len? opt->seed_len : 0x7fffffff;
+		// core function, reusing the hits buffer of the previous call
+		p->aln = bwt_match_gap_buf(bwt, p->len, seq, w, p->len <= opt->seed_len? 0 : seed_w, &local_opt,
+								   &p->n_aln, ws->stack, p->aln, &p->m_aln);
+	}
+	return n_exact;
+}
+
 #ifdef HAVE_PTHREAD
 typedef struct {
 	int tid;
@@ -31,6 +31,14 @@ typedef struct {
 	int bid;
 } bwt_width_t;
 
+typedef struct { // one backward search of bwa_cal_widths()
+	const bwt_t *bwt;
+	const ubyte_t *str;
+	bwt_width_t *width;
+	int len, i, bid;
+	bwtint_t k, l;
+} bwt_width_query_t;
+
 typedef struct {
 	uint32_t n_mm:8, n_gapo:8, n_gape:8, a:1;
 	bwtint_t k, l;
@@ -64,6 +72,7 @@ typedef struct {
 	// alignments in SA coordinates
 	int n_aln;
 	bwt_aln1_t *aln;
+	int m_aln; // size of aln, only kept by bwa_cal_sa_reg_gap_ws()
 	// multiple hits
 	int n_multi;
 	bwt_multi1_t *multi;
@@ -33,6 +33,54 @@ void gap_destroy_stack(gap_stack_t *stack)
 	free(stack);
 }
 
+gap_workspace_t *gap_init_workspace()
+{
+	return (gap_workspace_t*)calloc(1, sizeof(gap_workspace_t));
+}
+
+void gap_destroy_workspace(gap_workspace_t *ws)
+{
+	if (ws->stack) gap_destroy_stack(ws->stack);
+	free(ws->w[0]); free(ws->w[1]);
+	free(ws->seed_w[0]); free(ws->seed_w[1]);
+	free(ws->queries);
+	free(ws);
+}
+
+void gap_reserve_stack(gap_workspace_t *ws, int max_mm, int max_gapo, int max_gape, const gap_opt_t *opt)
+{
+	int i, n_stacks = aln_score(max_mm+1, max_gapo+1, max_gape+1, opt);
+	if (ws->stack == 0) {
+		ws->stack = gap_init_stack(max_mm, max_gapo, max_gape, opt);
+	} else if (ws->stack->n_stacks < n_stacks) { // unused score levels stay empty
+		gap_stack_t *stack = ws->stack;
+		stack->stacks = (gap_stack1_t*)realloc(stack->stacks, n_stacks * sizeof(gap_stack1_t));
+		for (i = stack->n_stacks; i != n_stacks; ++i) {
+			gap_stack1_t *p = stack->stacks + i;
+			p->n_entries = 0;
+			p->m_entries = 4;
+			p->stack = (gap_entry_t*)calloc(p->m_entries, sizeof(gap_entry_t));
+		}
+		stack->n_stacks = n_stacks;
+	}
+}
+
+void gap_reserve_widths(gap_workspace_t *ws, int n_seqs, int len, int seed_len)
+{
+	int i;
+	if (ws->m_seqs >= n_seqs && ws->m_w >= len + 1 && ws->m_seed_w >= seed_len + 1) return;
+	if (ws->m_seqs < n_seqs) ws->m_seqs = n_seqs;
+	if (ws->m_w < len + 1) ws->m_w = len + 1;
+	if (ws->m_seed_w < seed_len + 1) ws->m_seed_w = seed_len + 1;
+	for (i = 0; i != 2; ++i) { // widths are recomputed for every search, so nothing is copied
+		free(ws->w[i]); free(ws->seed_w[i]);
+		ws->w[i] = (bwt_width_t*)calloc(ws->m_seqs * ws->m_w, sizeof(bwt_width_t));
+		ws->seed_w[i] = (bwt_width_t*)calloc(ws->m_seqs * ws->m_seed_w, sizeof(bwt_width_t));
+	}
+	free(ws->queries);
+	ws->queries = (bwt_width_query_t*)calloc(4 * ws->m_seqs, sizeof(bwt_width_query_t));
+}
+
 static void gap_reset_stack(gap_stack_t *stack)
 {
 	int i;
@@ -103,22 +151,61 @@ static inline int int_log2(uint32_t v)
 
 bwt_aln1_t *bwt_match_gap(bwt_t *const bwts[2], int len, const ubyte_t *seq[2], bwt_width_t *w[2],
 						  bwt_width_t *seed_w[2], const gap_opt_t *opt, int *_n_aln, gap_stack_t *stack)
+{
+	int m_aln = 4;
+	bwt_aln1_t *aln = (bwt_aln1_t*)calloc(m_aln, sizeof(bwt_aln1_t));
+	return bwt_match_gap_buf(bwts, len, seq, w, seed_w, opt, _n_aln, stack, aln, &m_aln);
+}
+
+bwt_aln1_t *bwt_match_exact_buf(bwt_t *const bwts[2], int len, const ubyte_t *seq[2], bwt_width_t *w[2],
+								const gap_opt_t *opt, int *_n_aln, bwt_aln1_t *aln, int *_m_aln)
+{
+	int a, n_aln = 0, m_aln = *_m_aln, hit_cnt = 0;
+	if (m_aln < 4) {
+		m_aln = 4;
+		aln = (bwt_aln1_t*)realloc(aln, m_aln * sizeof(bwt_aln1_t));
+	}
+	memset(aln, 0, m_aln * sizeof(bwt_aln1_t));
+	for (a = 1; a >= 0; --a) { // bwt_match_gap_buf() pops strand 1 from the stack first
+		bwtint_t k = 0, l = bwts[0]->seq_len;
+		bwt_aln1_t *p;
+		if (len > 0) {
+			if (w[a][len-1].bid > 0) continue; // no exact match, as the widths already show
+			if (!bwt_match_exact_alt(bwts[1-a], len, seq[a], &k, &l)) continue;
+		}
+		p = aln + n_aln++;
+		p->a = a; p->k = k; p->l = l;
+		hit_cnt += l - k + 1;
+		if ((opt->max_hits_quit_aln != -1) && (hit_cnt > opt->max_hits_quit_aln)) break;
+	}
+	*_n_aln = n_aln;
+	*_m_aln = m_aln;
+	return aln;
+}
+
+bwt_aln1_t *bwt_match_gap_buf(bwt_t *const bwts[2], int len, const ubyte_t *seq[2], bwt_width_t *w[2],
+							  bwt_width_t *seed_w[2], const gap_opt_t *opt, int *_n_aln, gap_stack_t *stack,
+							  bwt_aln1_t *aln, int *_m_aln)
 {
 	int best_score = aln_score(opt->max_diff+1, opt->max_gapo+1, opt->max_gape+1, opt);
 	int best_diff = opt->max_diff + 1, max_diff = opt->max_diff;
 	int best_cnt = 0;
 	int hit_cnt = 0; // Number of alignment hits found so far
 	int max_entries = 0, j, _j, n_aln, m_aln;
-	bwt_aln1_t *aln;
 
-	m_aln = 4; n_aln = 0;
-	aln = (bwt_aln1_t*)calloc(m_aln, sizeof(bwt_aln1_t));
+	m_aln = *_m_aln; n_aln = 0;
+	if (m_aln < 4) {
+		m_aln = 4;
+		aln = (bwt_aln1_t*)realloc(aln, m_aln * sizeof(bwt_aln1_t));
+	}
+	memset(aln, 0, m_aln * sizeof(bwt_aln1_t));
 
 	// check whether there are too many N
 	for (j = _j = 0; j < len; ++j)
 		if (seq[0][j] > 3) ++_j;
 	if (_j > max_diff) {
 		*_n_aln = n_aln;
+		*_m_aln = m_aln;
 		return aln;
 	}
 
@@ -262,6 +349,7 @@ bwt_aln1_t *bwt_match_gap(bwt_t *const bwts[2], int len, const ubyte_t *seq[2],
 	}
 
 	*_n_aln = n_aln;
+	*_m_aln = m_aln;
 	//fprintf(stderr, "max_entries = %d\n", max_entries);
 	return aln;
 }
@@ -21,6 +21,13 @@ typedef struct {
 	gap_stack1_t *stacks;
 } gap_stack_t;
 
+typedef struct { // buffers of bwa_cal_sa_reg_gap_ws(), kept across calls
+	gap_stack_t *stack;
+	bwt_width_t *w[2], *seed_w[2]; // m_seqs blocks of m_w and m_seed_w entries
+	int m_seqs, m_w, m_seed_w;
+	bwt_width_query_t *queries; // 4*m_seqs
+} gap_workspace_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +38,27 @@ extern "C" {
 							  bwt_width_t *seed_w[2], const gap_opt_t *opt, int *_n_aln, gap_stack_t *stack);
 	void bwa_aln2seq(int n_aln, const bwt_aln1_t *aln, bwa_seq_t *s);
 
+	gap_workspace_t *gap_init_workspace();
+	void gap_destroy_workspace(gap_workspace_t *ws);
+	/* Grow the gap stack of the workspace for the given limits */
+	void gap_reserve_stack(gap_workspace_t *ws, int max_mm, int max_gapo, int max_gape, const gap_opt_t *opt);
+	/* Grow the width arrays of the workspace for n_seqs reads of up to len bases */
+	void gap_reserve_widths(gap_workspace_t *ws, int n_seqs, int len, int seed_len);
+	/* bwt_match_gap() writing the hits to aln, which holds *m_aln entries and is grown as needed */
+	bwt_aln1_t *bwt_match_gap_buf(bwt_t *const bwt[2], int len, const ubyte_t *seq[2], bwt_width_t *w[2],
+								  bwt_width_t *seed_w[2], const gap_opt_t *opt, int *_n_aln, gap_stack_t *stack,
+								  bwt_aln1_t *aln, int *m_aln);
+	/* bwt_match_gap_buf() for opt->max_diff == 0, reporting the same hits in the same order without the
+	   priority stack. w holds the widths of seq */
+	bwt_aln1_t *bwt_match_exact_buf(bwt_t *const bwt[2], int len, const ubyte_t *seq[2], bwt_width_t *w[2],
+									const gap_opt_t *opt, int *_n_aln, bwt_aln1_t *aln, int *m_aln);
+	/* Search each of seqs with opts[i] as bwa_cal_sa_reg_gap() searches it alone, keeping all buffers in
+	   ws and in the reads: p->aln is reused and p->seq, p->rseq, p->qual and p->name are left to the
+	   caller. The exact-match widths of all the reads are computed together, interleaving their
+	   FM-index lookups. Reads allowed no differences only get an exact search; returns their number */
+	int bwa_cal_sa_reg_gap_ws(gap_workspace_t *ws, bwt_t *const bwt[2], int n_seqs, bwa_seq_t *seqs,
+							   const gap_opt_t *opts);
+
 #ifdef __cplusplus
 }
 #endif
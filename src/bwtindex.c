@@ -33,6 +33,8 @@
 #include <zlib.h>
 #include "bntseq.h"
 #include "bwt.h"
+#include "kmerfilter.h"
+#include "mzindex.h"
 #include "main.h"
 #include "utils.h"
 
@@ -42,10 +44,11 @@ void bwa_pac_rev_core(const char *fn, const char *fn_rev);
 int bwa_index(int argc, char *argv[])
 {
 	char *prefix = 0, *str, *str2, *str3;
-	int c, algo_type = 3, is_color = 0;
+	int c, algo_type = 3, is_color = 0, filter_k = KMER_FILTER_DEFAULT_K;
+	int mz_k = 0, mz_w = MZ_INDEX_DEFAULT_W;
 	clock_t t;
 
-	while ((c = getopt(argc, argv, "ca:p:")) >= 0) {
+	while ((c = getopt(argc, argv, "ca:p:k:m:w:")) >= 0) {
 		switch (c) {
 		case 'a':
 			if (strcmp(optarg, "div") == 0) algo_type = 1;
@@ -55,6 +58,18 @@ int bwa_index(int argc, char *argv[])
 			break;
 		case 'p': prefix = strdup(optarg); break;
 		case 'c': is_color = 1; break;
+		case 'k':
+			filter_k = atoi(optarg);
+			if (filter_k > KMER_FILTER_MAX_K) err_fatal(__func__, "k-mer size can be at most %d.", KMER_FILTER_MAX_K);
+			break;
+		case 'm':
+			mz_k = atoi(optarg);
+			if (mz_k > MZ_INDEX_MAX_K) err_fatal(__func__, "minimizer k-mer size can be at most %d.", MZ_INDEX_MAX_K);
+			break;
+		case 'w':
+			mz_w = atoi(optarg);
+			if (mz_w <= 0 || mz_w > MZ_INDEX_MAX_W) err_fatal(__func__, "minimizer window must be between 1 and %d.", MZ_INDEX_MAX_W);
+			break;
 		default: return 1;
 		}
 	}
@@ -64,7 +79,11 @@ int bwa_index(int argc, char *argv[])
 		fprintf(stderr, "Usage:   bwa index [-a bwtsw|div|is] [-c] <in.fasta>\n\n");
 		fprintf(stderr, "Options: -a STR    BWT construction algorithm: bwtsw or is [is]\n");
 		fprintf(stderr, "         -p STR    prefix of the index [same as fasta name]\n");
-		fprintf(stderr, "         -c        build color-space index\n\n");
+		fprintf(stderr, "         -c        build color-space index\n");
+		fprintf(stderr, "         -k INT    k-mer size of the flank filter, 0 to skip it [%d]\n", KMER_FILTER_DEFAULT_K);
+		fprintf(stderr, "         -m INT    k-mer size of the minimizer index used by lobSTR --seeder\n");
+		fprintf(stderr, "                   minimizer (e.g. %d), 0 to skip it [0]\n", MZ_INDEX_DEFAULT_K);
+		fprintf(stderr, "         -w INT    minimizer window of the minimizer index [%d]\n\n", MZ_INDEX_DEFAULT_W);
 		fprintf(stderr,	"Warning: `-a bwtsw' does not work for short genomes, while `-a is' and\n");
 		fprintf(stderr, "         `-a div' do not work not for long genomes. Please choose `-a'\n");
 		fprintf(stderr, "         according to the length of the genome.\n\n");
@@ -181,6 +200,18 @@ int bwa_index(int argc, char *argv[])
 		bwt_destroy(bwt);
 		fprintf(stderr, "%.2f sec\n", (float)(clock() - t) / CLOCKS_PER_SEC);
 	}
+	if (is_color == 0 && filter_k > 0) {
+		t = clock();
+		fprintf(stderr, "[bwa_index] Build %d-mer filter for the packed sequence... ", filter_k);
+		kmer_filter_build(prefix, filter_k);
+		fprintf(stderr, "%.2f sec\n", (float)(clock() - t) / CLOCKS_PER_SEC);
+	}
+	if (is_color == 0 && mz_k > 0) {
+		t = clock();
+		fprintf(stderr, "[bwa_index] Build (%d,%d)-minimizer index for the packed sequence... ", mz_w, mz_k);
+		mz_index_build(prefix, mz_k, mz_w);
+		fprintf(stderr, "%.2f sec\n", (float)(clock() - t) / CLOCKS_PER_SEC);
+	}
 	free(str3); free(str2); free(str); free(prefix);
 	return 0;
 }
@@ -20,8 +20,11 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <err.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <map>
@@ -33,8 +36,11 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <utility>
 #include <vector>
 
+#include "src/BamCollatingFileReader.h"
 #include "src/BamFileReader.h"
 #include "src/BamPairedFileReader.h"
+#include "src/BamRecordReader.h"
+#include "src/BamRegionReader.h"
 #include "src/common.h"
 #include "src/FastaFileReader.h"
 #include "src/FastaPairedFileReader.h"
@@ -162,37 +168,60 @@ void TrimRead(const string& input_nucs,
               string* trimmed_nucs,
               string* trimmed_quals,
               int cutoff) {
+  TrimRead(input_nucs.data(), input_quals.data(), input_nucs.length(),
+           trimmed_nucs, trimmed_quals, cutoff);
+}
+
+void TrimRead(const char* input_nucs,
+              const char* input_quals,
+              size_t length,
+              string* trimmed_nucs,
+              string* trimmed_quals,
+              int cutoff) {
+  size_t trimmed_length = TrimmedReadLength(input_quals, length, cutoff);
+  trimmed_nucs->assign(input_nucs, trimmed_length);
+  trimmed_quals->assign(input_quals, trimmed_length);
+}
+
+size_t TrimmedReadLength(const char* input_quals, size_t length,
+                         int cutoff) {
   // if last bp is fine, return as is
-  size_t l = input_nucs.length();
+  size_t l = length;
+  if (l == 0) return 0;
   if (static_cast<int>(input_quals[l - 1] - QUALITY_CONSTANT)
       >= cutoff) {
-    *trimmed_nucs = input_nucs;
-    *trimmed_quals = input_quals;
-    return;
+    return l;
   }
 
   // else find the best place to chop
   // done according to bwa manual -q option
   // don't let read length go below minimum
+  // score(x) = sum_{i=x+1}^{l-1} (cutoff-q_i) is updated as x grows,
+  // rather than summed again for every x
   size_t max_x = min_read_length;
   int max_score = 0;
+  int score = 0;
+  for (size_t i = min_read_length+1; i < l; i++) {
+    score += (cutoff-(input_quals[i]-QUALITY_CONSTANT));
+  }
   for (size_t x = min_read_length; x <= l; x++) {
-    int score = 0;
-    for (size_t i = x+1; i < l; i++) {
-      score += (cutoff-(input_quals[i]-QUALITY_CONSTANT));
+    if (x > min_read_length && x < l) {
+      score -= (cutoff-(input_quals[x]-QUALITY_CONSTANT));
     }
     if (score >= max_score) {
       max_score = score;
       max_x = x;
     }
   }
-  *trimmed_nucs = input_nucs.substr(0, max_x + 1);
-  *trimmed_quals = input_quals.substr(0, max_x + 1);
+  return (max_x + 1 < l) ? max_x + 1 : l;
 }
 
 bool fexists(const char *filename) {
-  ifstream ifile(filename);
-  return ifile;
+  return access(filename, R_OK) == 0;
+}
+
+bool is_stdin(const string& filename) {
+  return filename == "-";
 }
 
 bool valid_nucleotides_string(const string &str) {
@@ -202,13 +231,25 @@ bool valid_nucleotides_string(const string &str) {
   return str.find_first_not_of("ACGTNacgtn");
 }
 
+bool valid_nucleotides_string(const char* str, size_t length) {
+  // Same test as the std::string version above
+  if (length == 0) {
+    return false;
+  }
+  return memchr("ACGTNacgtn", str[0], 10) != NULL;
+}
+
 double calculate_N_percentage(const std::string& nuc) {
+  return calculate_N_percentage(nuc.data(), nuc.length());
+}
+
+double calculate_N_percentage(const char* nuc, size_t length) {
   size_t n_count = 0;
-  for (size_t i = 0; i < nuc.length(); i++)
+  for (size_t i = 0; i < length; i++)
     if (nuc[i] == 'N' || nuc[i] == 'n')
       n_count++;
   return (static_cast<double>(n_count))/
-    (static_cast<double>(nuc.length()));
+    (static_cast<double>(length));
 }
 
 string reverseComplement(const string& nucs) {
@@ -251,36 +292,257 @@ int nucToNumber(const char& nuc) {
   }
 }
 
-bool CheckRepeatCount(const std::string& nucs, const size_t& k, const size_t& minlen, std::string* bestkmer) {
-  if (k < 1 || k > 6) {
-    PrintMessageDieOnError("Invalid kmer size for CheckRepeatCount", ERROR);
+const size_t MIN_REP_LENGTH[] = {8, 8, 8, 10, 10, 10};
+
+namespace {
+
+// Distinct kmers with characters other than ACGT counted per period
+// before falling back to counting all kmers in a map
+const size_t MAX_OTHER_KMERS = 16;
+
+/*
+  Counts the non-overlapping kmers of period K the way CheckRepeatCount
+  does, and keeps the first kmer to reach the highest count. ACGT kmers
+  are packed 2 bits per base and counted in a fixed array. Kmers with
+  other characters are rare and kept in a short list of their own.
+ */
+template <int K>
+class PeriodKmerCounter {
+ public:
+  void Reset() {
+    memset(_counts, 0, sizeof(_counts));
+    _max_count = 0;
+    _best_packed = 0;
+    _best_other = -1;
+    _num_other = 0;
+    _overflow = false;
+  }
+
+  // Count the kmer at nucs. packed holds its bases in the low 2*K bits,
+  // unless it has other characters
+  void Add(const char* nucs, uint32_t packed, bool has_other) {
+    unsigned int count;
+    if (!has_other) {
+      packed &= NUM_PACKED_KMERS-1;
+      count = ++_counts[packed];
+      if (count > _max_count) {
+        _max_count = count;
+        _best_packed = packed;
+        _best_other = -1;
+      }
+      return;
+    }
+    size_t i = 0;
+    while (i < _num_other && memcmp(_other[i], nucs, K) != 0) i++;
+    if (i == _num_other) {
+      if (_num_other == MAX_OTHER_KMERS) {
+        _overflow = true;
+        return;
+      }
+      memcpy(_other[i], nucs, K);
+      _other_counts[i] = 0;
+      _num_other++;
+    }
+    count = ++_other_counts[i];
+    if (count > _max_count) {
+      _max_count = count;
+      _best_other = i;
+    }
   }
-  if (nucs.size() < minlen) {
-    PrintMessageDieOnError("Nucs smaller than kmer*count size", ERROR);
+
+  // Too many distinct kmers with other characters to be counted here
+  bool overflow() const { return _overflow; }
+
+  // Write the most common kmer to kmer. Return false if no kmer was counted
+  bool BestKmer(char* kmer) const {
+    if (_max_count == 0) return false;
+    if (_best_other >= 0) {
+      memcpy(kmer, _other[_best_other], K);
+      return true;
+    }
+    for (int i = K-1; i >= 0; i--) {
+      kmer[K-1-i] = "ACGT"[(_best_packed >> (2*i)) & 3];
+    }
+    return true;
+  }
+
+ private:
+  static const uint32_t NUM_PACKED_KMERS = 1 << (2*K);
+  uint16_t _counts[NUM_PACKED_KMERS];
+  unsigned int _max_count;
+  uint32_t _best_packed;
+  int _best_other;
+  char _other[MAX_OTHER_KMERS][K];
+  uint16_t _other_counts[MAX_OTHER_KMERS];
+  size_t _num_other;
+  bool _overflow;
+};
+
+// Kmer counters of all periods checked by CheckRepeatCount
+struct RepeatKmerCounters {
+  PeriodKmerCounter<1> period1;
+  PeriodKmerCounter<2> period2;
+  PeriodKmerCounter<3> period3;
+  PeriodKmerCounter<4> period4;
+  PeriodKmerCounter<5> period5;
+  PeriodKmerCounter<6> period6;
+};
+
+// Longest read packed in a fixed array. Longer reads are counted in a map
+const size_t MAX_PACKED_READ_LENGTH = 1024;
+
+// A read packed once for the kmer counters of all periods
+struct PackedRead {
+  // The 6 bases ending at each position, 2 bits each
+  uint16_t packed[MAX_PACKED_READ_LENGTH];
+  // Kmers ending at a position and starting before this one
+  // have a character other than ACGT
+  uint16_t first_clean[MAX_PACKED_READ_LENGTH];
+};
+
+/* Count the kmers of period K CheckRepeatCount counts, from the packed read */
+template <int K>
+void CountPeriodKmers(const char* nucs, size_t length, const PackedRead& read,
+                      PeriodKmerCounter<K>* counter) {
+  counter->Reset();
+  for (size_t start = 0; start + K < length; start += K) {
+    size_t end = start + K - 1;
+    counter->Add(nucs + start, read.packed[end], start < read.first_clean[end]);
   }
-  // Get most common kmer
+}
+
+/*
+  Pack nucs in a single pass and count the kmers of periods min_k to
+  max_k. Return false if the read is too long, or if a period had too
+  many kmers with other characters than ACGT, to be counted here
+ */
+bool CountKmers(const std::string& nucs, size_t min_k, size_t max_k,
+                RepeatKmerCounters* counters) {
+  const char* seq = nucs.data();
+  const size_t length = nucs.size();
+  if (length > MAX_PACKED_READ_LENGTH) return false;
+  PackedRead read;
+  uint32_t packed = 0;
+  uint16_t first_clean = 0;
+  for (size_t i = 0; i < length; i++) {
+    int code = nucToNumber(seq[i]);
+    if (code > 3) {
+      first_clean = i + 1;
+      code = 0;
+    }
+    packed = ((packed << 2) | code) & 0xfff;
+    read.packed[i] = packed;
+    read.first_clean[i] = first_clean;
+  }
+  bool overflow = false;
+  for (size_t k = min_k; k <= max_k; k++) {
+    switch (k) {
+    case 1:
+      CountPeriodKmers(seq, length, read, &counters->period1);
+      overflow |= counters->period1.overflow();
+      break;
+    case 2:
+      CountPeriodKmers(seq, length, read, &counters->period2);
+      overflow |= counters->period2.overflow();
+      break;
+    case 3:
+      CountPeriodKmers(seq, length, read, &counters->period3);
+      overflow |= counters->period3.overflow();
+      break;
+    case 4:
+      CountPeriodKmers(seq, length, read, &counters->period4);
+      overflow |= counters->period4.overflow();
+      break;
+    case 5:
+      CountPeriodKmers(seq, length, read, &counters->period5);
+      overflow |= counters->period5.overflow();
+      break;
+    default:
+      CountPeriodKmers(seq, length, read, &counters->period6);
+      overflow |= counters->period6.overflow();
+      break;
+    }
+  }
+  return !overflow;
+}
+
+/* Most common kmer of period k, or false if there is none */
+bool BestKmer(const RepeatKmerCounters& counters, size_t k, char* kmer) {
+  switch (k) {
+  case 1: return counters.period1.BestKmer(kmer);
+  case 2: return counters.period2.BestKmer(kmer);
+  case 3: return counters.period3.BestKmer(kmer);
+  case 4: return counters.period4.BestKmer(kmer);
+  case 5: return counters.period5.BestKmer(kmer);
+  default: return counters.period6.BestKmer(kmer);
+  }
+}
+
+/* Most common kmer of period k, counted in a map */
+bool CountKmersInMap(const std::string& nucs, size_t k, char* kmer) {
   map<string, int> countKMers;
   std::string subseq;
-  subseq.resize(k);
-  std::string kmer = "";
   int maxkmer = 0;
   for (size_t i = 0; i < nucs.size() - k; i=i+k) {
     subseq = nucs.substr(i, k);
     countKMers[subseq]++;
     if (countKMers[subseq] > maxkmer) {
-      kmer = subseq;
+      memcpy(kmer, subseq.data(), k);
       maxkmer = countKMers[subseq];
     }
   }
-  *bestkmer = kmer;
-  // Check that we have enough consecutive occurrences of the kmer
-  stringstream kmerrep;
-  size_t s = 0;
-  while (s < minlen) {
-    kmerrep << kmer;
-    s += kmer.size();
+  return maxkmer > 0;
+}
+
+/* Whether nucs contains kmer repeated over minlen nucleotides */
+bool HasRepeat(const std::string& nucs, const char* kmer, size_t k,
+               size_t minlen) {
+  char repeat[64];
+  if (minlen > sizeof(repeat)) {
+    std::string long_repeat;
+    while (long_repeat.size() < minlen) long_repeat.append(kmer, k);
+    return nucs.find(long_repeat.data(), 0, minlen) != std::string::npos;
+  }
+  for (size_t i = 0; i < minlen; i++) {
+    repeat[i] = kmer[i % k];
   }
-  return nucs.find(kmerrep.str().substr(0, minlen)) != std::string::npos;
+  return nucs.find(repeat, 0, minlen) != std::string::npos;
+}
+
+/* Check the periods min_k to max_k in order, return the first one that passes, 0 if none */
+size_t FirstRepeatedPeriod(const std::string& nucs, size_t min_k, size_t max_k,
+                           const size_t* minlens, std::string* bestkmer) {
+  RepeatKmerCounters counters;
+  // Counts have to fit the fixed arrays
+  bool counted = CountKmers(nucs, min_k, max_k, &counters);
+  char kmer[6];
+  for (size_t k = min_k; k <= max_k; k++) {
+    if (nucs.size() < minlens[k-min_k]) {
+      PrintMessageDieOnError("Nucs smaller than kmer*count size", ERROR);
+    }
+    bool found = counted ? BestKmer(counters, k, kmer) :
+      CountKmersInMap(nucs, k, kmer);
+    if (bestkmer != NULL) {
+      bestkmer->assign(kmer, found ? k : 0);
+    }
+    if (found && HasRepeat(nucs, kmer, k, minlens[k-min_k])) {
+      return k;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+bool CheckRepeatCount(const std::string& nucs, const size_t& k, const size_t& minlen, std::string* bestkmer) {
+  if (k < 1 || k > 6) {
+    PrintMessageDieOnError("Invalid kmer size for CheckRepeatCount", ERROR);
+  }
+  return FirstRepeatedPeriod(nucs, k, k, &minlen, bestkmer) != 0;
+}
+
+bool CheckRepeatCounts(const std::string& nucs) {
+  return FirstRepeatedPeriod(nucs, 1, 6, &MIN_REP_LENGTH[1-MIN_PERIOD], NULL) != 0;
 }
 
 std::string reverse(const std::string& s) {
@@ -297,7 +559,12 @@ IFileReader* create_file_reader(const string& filename1,
                                 const string& filename2) {
   switch (input_type) {
     case INPUT_FASTA:
-      if (paired) {
+      if (paired && interleaved) {
+        if (gzip) {
+          return new FastaPairedFileReader(new ZippedFastaFileReader(filename1));
+        }
+        return new FastaPairedFileReader(new FastaFileReader(filename1));
+      } else if (paired) {
         return new FastaPairedFileReader(filename1, filename2);
       } else {
         if (gzip) {
@@ -307,7 +574,12 @@ IFileReader* create_file_reader(const string& filename1,
         }
       }
   case INPUT_FASTQ:
-    if (paired) {
+    if (paired && interleaved) {
+      if (gzip) {
+        return new FastqPairedFileReader(new ZippedFastqFileReader(filename1));
+      }
+      return new FastqPairedFileReader(new FastqFileReader(filename1));
+    } else if (paired) {
       return new FastqPairedFileReader(filename1, filename2);
     } else {
       if (gzip) {
@@ -318,6 +590,9 @@ IFileReader* create_file_reader(const string& filename1,
     }
   case INPUT_BAM:
     if (paired) {
+      if (collate_pairs) {
+        return new BamCollatingFileReader(filename1);
+      }
       return new BamPairedFileReader(filename1);
     } else {
       return new BamFileReader(filename1);
@@ -329,6 +604,13 @@ IFileReader* create_file_reader(const string& filename1,
   }
 }
 
+IBamRecordSource* create_bam_record_source(const string& filename) {
+  if (str_regions) {
+    return new BamRegionReader(filename);
+  }
+  return new BamRecordReader(filename);
+}
+
 void GenerateCorrectCigar(CIGAR_LIST* cigar_list,
                           const std::string& nucs,
                           bool* added_s,
@@ -36,8 +36,16 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include "src/IFileReader.h"
 #include "src/ReferenceSTR.h"
 
+class FlankFilter;
+class MinimizerIndex;
+class IBamRecordSource;
+
 struct  BWT {
   bwt_t *bwt[2];
+  // k-mer filter over the indexed sequence, NULL if not used
+  const FlankFilter* flank_filter;
+  // minimizer index of the indexed sequence, NULL if not used
+  const MinimizerIndex* minimizer_index;
 };
 
 struct BNT {
@@ -95,21 +103,42 @@ void TrimRead(const std::string& input_nucs,
               std::string* trimmed_nucs,
               std::string* trimmed_quals,
               int cutoff);
+// same, for a read that is not held in strings
+void TrimRead(const char* input_nucs,
+              const char* input_quals,
+              size_t length,
+              std::string* trimmed_nucs,
+              std::string* trimmed_quals,
+              int cutoff);
+// length TrimRead trims a read to
+size_t TrimmedReadLength(const char* input_quals, size_t length, int cutoff);
 
-// check if a file exists
+// check if a file exists. The file is not opened, so named pipes
+// are left untouched
 bool fexists(const char *filename);
 
+// check if a file name stands for standard input ("-")
+bool is_stdin(const std::string& filename);
+
 // check if the string contains only valid nucleotides
 bool valid_nucleotides_string(const std::string &str);
+bool valid_nucleotides_string(const char* str, size_t length);
 
 // get the percentage of N's in the read
 double calculate_N_percentage(const std::string& nucleotides);
+double calculate_N_percentage(const char* nucleotides, size_t length);
 
 // convert nucleotide to number
 int nucToNumber(const char& nuc);
 
 // check for number of repeats of most common kmer
 bool CheckRepeatCount(const std::string& nucs, const size_t& k, const size_t& minlen, std::string* bestkmer);
+// CheckRepeatCount for periods 1 to 6 with MIN_REP_LENGTH, counting
+// the kmers of all periods in one pass. True if any period passes
+bool CheckRepeatCounts(const std::string& nucs);
+// Repeat length required by the detector's repeat check, per period
+// starting at MIN_PERIOD
+extern const size_t MIN_REP_LENGTH[];
 
 // get the reverse complement of a nucleotide string
 std::string reverseComplement(const std::string& nucs);
@@ -124,6 +153,10 @@ char complement(const char nucleotide);
 IFileReader* create_file_reader(const std::string& filename1,
                                 const std::string& filename2);
 
+// get the source of input bam records: the whole file, or only the
+// reads near STRs with --str-regions
+IBamRecordSource* create_bam_record_source(const std::string& filename);
+
 // make sure cigar string is valid
 void GenerateCorrectCigar(CIGAR_LIST* cigar_list,
                           const std::string& nucs,
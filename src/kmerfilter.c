@@ -0,0 +1,94 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bntseq.h"
+#include "kmerfilter.h"
+#include "utils.h"
+
+static void kmer_filter_insert(uint64_t *blocks, uint64_t num_blocks, uint64_t kmer)
+{
+	uint64_t probes;
+	uint64_t *block = (uint64_t*)kmer_filter_block(blocks, num_blocks, kmer, &probes);
+	int i;
+	for (i = 0; i < KMER_FILTER_NUM_PROBES; ++i, probes >>= KMER_FILTER_PROBE_BITS) {
+		int bit = (int)(probes & ((1 << KMER_FILTER_PROBE_BITS) - 1));
+		block[bit >> 6] |= 1ULL << (bit & 63);
+	}
+}
+
+void kmer_filter_build(const char *prefix, int k)
+{
+	bntseq_t *bns;
+	char *name;
+	FILE *fp;
+	uint8_t *pac;
+	int64_t i, l_pac, pac_size, n_kmers;
+	uint64_t *blocks, num_blocks, mask, fwd = 0, rev = 0;
+	kmer_filter_header_t header;
+	int shift = (k - 1) << 1;
+
+	xassert(k > 0 && k <= KMER_FILTER_MAX_K, "k-mer size out of range.");
+	bns = bns_restore(prefix);
+	l_pac = bns->l_pac;
+	bns_destroy(bns);
+	name = (char*)calloc(strlen(prefix) + 10, 1);
+	// the k-mers come from the .pac file rather than the fasta: the BWT
+	// is built from it, including the random bases that replace N
+	strcpy(name, prefix); strcat(name, ".pac");
+	fp = xopen(name, "rb");
+	pac_size = l_pac / 4 + 1;
+	pac = (uint8_t*)calloc(pac_size, 1);
+	xassert(fread(pac, 1, pac_size, fp) == (size_t)pac_size, "truncated .pac file.");
+	fclose(fp);
+
+	n_kmers = l_pac >= k? l_pac - k + 1 : 1;
+	num_blocks = (n_kmers * KMER_FILTER_BITS_PER_KMER + KMER_FILTER_BLOCK_WORDS * 64 - 1)
+		/ (KMER_FILTER_BLOCK_WORDS * 64);
+	blocks = (uint64_t*)calloc(num_blocks * KMER_FILTER_BLOCK_WORDS, sizeof(uint64_t));
+	xassert(blocks, "not enough memory for the k-mer filter.");
+	mask = k == 32? ~0ULL : (1ULL << (k << 1)) - 1;
+	// both strands go in as the smaller of a k-mer and its reverse complement
+	for (i = 0; i < l_pac; ++i) {
+		uint64_t c = pac[i >> 2] >> ((~i & 3) << 1) & 3;
+		fwd = (fwd << 2 | c) & mask;
+		rev = rev >> 2 | (3 - c) << shift;
+		if (i + 1 >= k) kmer_filter_insert(blocks, num_blocks, fwd < rev? fwd : rev);
+	}
+	free(pac);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, KMER_FILTER_MAGIC, sizeof(header.magic));
+	header.version = KMER_FILTER_VERSION;
+	header.k = k;
+	header.num_probes = KMER_FILTER_NUM_PROBES;
+	header.num_blocks = num_blocks;
+	strcpy(name, prefix); strcat(name, ".kmf");
+	fp = xopen(name, "wb");
+	xassert(fwrite(&header, sizeof(header), 1, fp) == 1, "failed to write the k-mer filter.");
+	xassert(fwrite(blocks, sizeof(uint64_t) * KMER_FILTER_BLOCK_WORDS, num_blocks, fp) == num_blocks,
+			"failed to write the k-mer filter.");
+	fclose(fp);
+	free(blocks);
+	free(name);
+}
@@ -0,0 +1,100 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_KMERFILTER_H__
+#define SRC_KMERFILTER_H__
+
+#include <stdint.h>
+
+/*
+  Blocked Bloom filter over the canonical k-mers of the indexed
+  reference. lobSTRIndex writes it next to the BWT files as
+  <prefix>.kmf, lobSTR uses it to skip the BWT search of flanks
+  that share no k-mer with the reference.
+
+  File layout: a kmer_filter_header_t, then num_blocks blocks of
+  KMER_FILTER_BLOCK_WORDS 64 bit words. Each k-mer sets num_probes
+  bits in a single block, so a lookup touches one cache line.
+ */
+
+#define KMER_FILTER_MAGIC "LOBSTRKF"
+#define KMER_FILTER_VERSION 1
+#define KMER_FILTER_DEFAULT_K 20
+#define KMER_FILTER_MAX_K 32
+#define KMER_FILTER_BITS_PER_KMER 12
+#define KMER_FILTER_NUM_PROBES 7
+#define KMER_FILTER_BLOCK_WORDS 8
+#define KMER_FILTER_PROBE_BITS 9
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t k;
+	uint32_t num_probes;
+	uint32_t reserved;
+	uint64_t num_blocks;
+} kmer_filter_header_t;
+
+/* 64 bit finalizer of MurmurHash3 */
+static inline uint64_t kmer_filter_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+/* Block of a k-mer, and the probe bits inside it */
+static inline const uint64_t *kmer_filter_block(const uint64_t *blocks, uint64_t num_blocks,
+												uint64_t kmer, uint64_t *probes)
+{
+	uint64_t h = kmer_filter_hash(kmer);
+	*probes = kmer_filter_hash(h ^ 0x9e3779b97f4a7c15ULL);
+	return blocks + (h % num_blocks) * KMER_FILTER_BLOCK_WORDS;
+}
+
+/* Returns 1 if the canonical k-mer may be in the filter, 0 if it is not */
+static inline int kmer_filter_contains(const uint64_t *blocks, uint64_t num_blocks,
+									   int num_probes, uint64_t kmer)
+{
+	uint64_t probes;
+	const uint64_t *block = kmer_filter_block(blocks, num_blocks, kmer, &probes);
+	int i;
+	for (i = 0; i < num_probes; ++i, probes >>= KMER_FILTER_PROBE_BITS) {
+		int bit = (int)(probes & ((1 << KMER_FILTER_PROBE_BITS) - 1));
+		if (!(block[bit >> 6] >> (bit & 63) & 1)) return 0;
+	}
+	return 1;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/* Build <prefix>.kmf from <prefix>.pac and <prefix>.ann */
+	void kmer_filter_build(const char *prefix, int k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SRC_KMERFILTER_H__ */
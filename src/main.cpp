@@ -28,6 +28,7 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <unistd.h>
 
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <iostream>
 #include <list>
 #include <map>
@@ -42,11 +43,15 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include "src/common.h"
 #include "src/FastaFileReader.h"
 #include "src/FastqFileReader.h"
+#include "src/FlankFilter.h"
 #include "src/IFileReader.h"
+#include "src/MinimizerIndex.h"
 #include "src/MSReadRecord.h"
 #include "src/MultithreadData.h"
 #include "src/SamFileWriter.h"
 #include "src/STRDetector.h"
+#include "src/STRPrescreen.h"
+#include "src/TextChunkReader.h"
 #include "src/runtime_parameters.h"
 
 using namespace std;
@@ -59,6 +64,9 @@ vector<string> input_files2;
 // keep track of # bases so we can calculate coverage
 int bases = 0;
 
+// guards the run stats the alignment threads add to
+static pthread_mutex_t run_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // keep track of reference genome to use for sam format
 map<string, int> chrom_sizes;
 
@@ -71,6 +79,8 @@ std::string unit_name;
 // alignment references, keep global
 BNT bnt_annotation;
 BWT bwt_reference;
+FlankFilter flank_filter;
+MinimizerIndex minimizer_index;
 void LoadReference();
 void DestroyReference();
 gap_opt_t *opts;
@@ -84,13 +94,17 @@ void show_help() {
 	   << "Parameter descriptions:\n "
 	   << "-f,--files    file or comma-separated list of files\n"
 	   << "               containing reads in fasta, fastq, or bam format\n"
-	   << "               (default: fasta)\n"
+	   << "               (default: fasta). \"-\" reads from standard input,\n"
+	   << "               named pipes are read like files\n"
 	   << "--p1           file or comma-separated list of files containing\n"
 	   << "               the first end of paired end reads in fasta or fastq\n"
 	   << "               (default: fasta)\n"
 	   << "--p2           file or comma-separated list of files containing\n"
 	   << "               the second end of paired end reads in fasta or fastq\n"
 	   << "               (default: fasta)\n"
+	   << "--interleaved  reads given with -f are paired end, with the\n"
+	   << "               second end of each pair right after the first\n"
+	   << "               (fasta or fastq only)\n"
 	   << "-o,--out       prefix for output files. will output:\n"
 	   << "                  <prefix>.aligned.bam: bam file of alignments\n"
 	   << "                  <prefix>.aligned.stats: give statistics about alignments\n"
@@ -109,9 +123,26 @@ void show_help() {
 	   << "--bam          reads are in bam format (default: fasta)\n"
 	   << "--gzip         The input files are gzipped\n"
 	   << "               (only works for fasta or fastq input)\n"
+	   << "               BGZF (bgzip) files are detected automatically and\n"
+	   << "               decompressed on -p threads\n"
+	   << "--mmap         Memory-map uncompressed fasta/fastq input files\n"
+	   << "               instead of reading them through a stream. Useful\n"
+	   << "               for input on fast local disks\n"
 	   << "--bampair      reads are in bam format and are paired-end\n"
 	   << "               NOTE: bam file MUST be sorted by read name\n"
 	   << "               (samtools sort -n <file.bam> <prefix>)\n"
+	   << "               unless --collate-pairs is given\n"
+	   << "--collate-pairs  with --bampair, pair mates of a bam file in any\n"
+	   << "               order, e.g. sorted by coordinate\n"
+	   << "--collate-max-pending <INT>  with --collate-pairs, number of mates\n"
+	   << "               held in memory while waiting for their pair before\n"
+	   << "               they are spilled to temporary files in $TMPDIR\n"
+	   << "               (default: " << collate_max_pending << ")\n"
+	   << "--str-regions  with --bam or --bampair, only read the reads of\n"
+	   << "               a coordinate-sorted, indexed bam file that lie\n"
+	   << "               near an STR of the index, and unmapped reads\n"
+	   << "--str-region-padding <INT>  with --str-regions, bp read on each\n"
+	   << "               side of an STR (default: " << str_region_padding << ")\n"
 	   << "--bwaq         Trim read ends based on quality scores. This\n"
 	   << "               has the same effect as the BWA parameter -q:\n"
 	   << "               BWA trims a read down to argmax_x{sum_{i=x+1}^l(INT-q_i)} \n"
@@ -123,6 +154,21 @@ void show_help() {
 	   << "               Alternate alignments given in XA tag\n"
 	   << "\n\nAdvanced options - general:\n"
 	   << "-p,--threads <INT>         number of threads (default:" << threads << ")\n"
+	   << "--batch-size <INT>         number of reads handed to an alignment\n"
+	   << "                           thread at a time when using multiple\n"
+	   << "                           threads (default: " << batch_size << ")\n"
+	   << "--parse-threads <INT>      number of extra threads parsing uncompressed\n"
+	   << "                           fasta/fastq input. 0 parses all input in\n"
+	   << "                           the reading thread (default: " << parse_threads << ")\n"
+	   << "--file-threads <INT>       number of input files (or file pairs) read\n"
+	   << "                           at the same time when using multiple\n"
+	   << "                           threads (default: " << file_threads << ")\n"
+	   << "--ordered-output           write alignments in input order when using\n"
+	   << "                           multiple threads, so the output is the same\n"
+	   << "                           as with a single thread\n"
+	   << "--reorder-window <INT>     with --ordered-output, maximum number of\n"
+	   << "                           batches read ahead of the output writer\n"
+	   << "                           (default: " << reorder_window << ")\n"
 	   << "--min-read-length <INT>    minimum number of nucleotides for a\n"
 	   << "                           read to be processed.\n"
 	   << "                           (default: " << min_read_length << ")\n"
@@ -139,6 +185,20 @@ void show_help() {
 	   << "--maxflank <INT>           length to trim the ends of flanking\n"
 	   << "                           regions to if they exceed that length\n"
 	   << "                           (default: " << max_flank_len << ")\n"
+	   << "--no-prescreen             build every read and run the full detection\n"
+	   << "                           on it. By default reads with\n"
+	   << "                           no short periodic stretch, too many Ns\n"
+	   << "                           or too few bases are dropped while parsing\n"
+	   << "--prescreen-check          build and run detection on reads the\n"
+	   << "                           pre-screen drops, and report any that\n"
+	   << "                           pass detection\n"
+	   << "--detector <STRING>        how STRs are located in reads: \"entropy\"\n"
+	   << "                           (sliding window entropy and kmer counts)\n"
+	   << "                           or \"autocorrelation\" (runs of bases\n"
+	   << "                           matching the base 1-6bp before them)\n"
+	   << "                           (default: entropy)\n"
+	   << "--detector-check           run both detectors and report how often\n"
+	   << "                           they agree\n"
 	   << "\n\nAdvanced options - alignment:\n"
 	   << "--max-diff-ref <INT>       maximum difference in length from\n"
 	   << "                           the reference sequence to report\n"
@@ -167,6 +227,25 @@ void show_help() {
 	   << "                           Default: " << max_hits_quit_aln << ". Use -1 for no limit.\n"
 	   << "--min-flank-allow-mismatch <int>  Mininum length of flanking region to allow\n"
 	   << "                           mismatches. Default: " << min_length_to_allow_mismatches << ".\n"
+	   << "--no-flank-filter          search every flank in the BWT index, even\n"
+	   << "                           if the index k-mer filter shows it\n"
+	   << "                           can not align\n"
+	   << "--anchor-verify            once one flank aligns uniquely, look for\n"
+	   << "                           the other only in the same STR locus\n"
+	   << "                           instead of searching the whole index.\n"
+	   << "                           A flank found in the locus with at\n"
+	   << "                           most one mismatch is not held to the\n"
+	   << "                           limit on hits per flank that a search\n"
+	   << "                           applies. Only used with --seeder bwt\n"
+	   << "--seeder <STRING>          how flanks are located in the index: \"bwt\"\n"
+	   << "                           (BWT search) or \"minimizer\" (minimizer\n"
+	   << "                           hash lookups checked by a banded\n"
+	   << "                           alignment, needs an index built with\n"
+	   << "                           lobSTRIndex -m; flanks too short to be\n"
+	   << "                           sure of every hit are searched in the\n"
+	   << "                           BWT) (default: bwt)\n"
+	   << "--seeder-check             align flanks with both seeders and report\n"
+	   << "                           how often they agree\n"
 	   << "This program takes in raw reads, detects and aligns reads\n"
 	   << "containing microsatellites, and genotypes STR locations.\n\n";
   cerr << help_msg.str();
@@ -181,7 +260,9 @@ void parse_commandline_options(int argc, char* argv[]) {
     OPT_FILES,
     OPT_PAIR1,
     OPT_PAIR2,
+    OPT_INTERLEAVED,
     OPT_GZIP,
+    OPT_MMAP,
     OPT_GENOME,
     OPT_OUTPUT,
     OPT_HELP,
@@ -192,7 +273,16 @@ void parse_commandline_options(int argc, char* argv[]) {
     OPT_FASTQ,
     OPT_BAM,
     OPT_BAMPAIR,
+    OPT_COLLATE_PAIRS,
+    OPT_COLLATE_MAX_PENDING,
+    OPT_STR_REGIONS,
+    OPT_STR_REGION_PADDING,
     OPT_THREADS,
+    OPT_BATCH_SIZE,
+    OPT_PARSE_THREADS,
+    OPT_FILE_THREADS,
+    OPT_ORDERED_OUTPUT,
+    OPT_REORDER_WINDOW,
     OPT_MISMATCH,
     OPT_NOWEB,
     OPT_RMDUP,
@@ -202,8 +292,16 @@ void parse_commandline_options(int argc, char* argv[]) {
     OPT_EXTEND,
     OPT_MIN_FLANK_ALLOW_MISMATCH,
     OPT_MAX_HITS_QUIT_ALN,
+    OPT_NO_FLANK_FILTER,
+    OPT_ANCHOR_VERIFY,
+    OPT_SEEDER,
+    OPT_SEEDER_CHECK,
     OPT_MIN_FLANK_LEN,
     OPT_MAX_FLANK_LEN,
+    OPT_NO_PRESCREEN,
+    OPT_PRESCREEN_CHECK,
+    OPT_DETECTOR,
+    OPT_DETECTOR_CHECK,
     OPT_MAX_DIFF_REF,
     OPT_MULTI,
     OPT_MIN_READ_LENGTH,
@@ -230,10 +328,17 @@ void parse_commandline_options(int argc, char* argv[]) {
     {"files", 1, 0, OPT_FILES},
     {"p1", 1, 0, OPT_PAIR1},
     {"p2", 1, 0, OPT_PAIR2},
+    {"interleaved", 0, 0, OPT_INTERLEAVED},
     {"gzip", 0, 0, OPT_GZIP},
+    {"mmap", 0, 0, OPT_MMAP},
     {"genome", 1, 0, OPT_GENOME},
     {"out", 1, 0, OPT_OUTPUT},
     {"threads", 1, 0, OPT_THREADS},
+    {"batch-size", 1, 0, OPT_BATCH_SIZE},
+    {"parse-threads", 1, 0, OPT_PARSE_THREADS},
+    {"file-threads", 1, 0, OPT_FILE_THREADS},
+    {"ordered-output", 0, 0, OPT_ORDERED_OUTPUT},
+    {"reorder-window", 1, 0, OPT_REORDER_WINDOW},
     {"noweb", 0, 0, OPT_NOWEB},
     {"mismatch", 1, 0, OPT_MISMATCH},
     {"fft-window-size", 1, 0, OPT_FFT_WINDOW_SIZE},
@@ -242,6 +347,10 @@ void parse_commandline_options(int argc, char* argv[]) {
     {"extend", 1, 0, OPT_EXTEND},
     {"minflank", 1, 0, OPT_MIN_FLANK_LEN},
     {"maxflank", 1, 0, OPT_MAX_FLANK_LEN},
+    {"no-prescreen", 0, 0, OPT_NO_PRESCREEN},
+    {"prescreen-check", 0, 0, OPT_PRESCREEN_CHECK},
+    {"detector", 1, 0, OPT_DETECTOR},
+    {"detector-check", 0, 0, OPT_DETECTOR_CHECK},
     {"max-diff-ref", 1, 0, OPT_MAX_DIFF_REF},
     {"multi", 0, 0, OPT_MULTI},
     {"help", 0, 0, OPT_HELP},
@@ -251,11 +360,19 @@ void parse_commandline_options(int argc, char* argv[]) {
     {"fastq", 0, 0, OPT_FASTQ},
     {"bam", 0, 0, OPT_BAM},
     {"bampair", 0, 0, OPT_BAMPAIR},
+    {"collate-pairs", 0, 0, OPT_COLLATE_PAIRS},
+    {"collate-max-pending", 1, 0, OPT_COLLATE_MAX_PENDING},
+    {"str-regions", 0, 0, OPT_STR_REGIONS},
+    {"str-region-padding", 1, 0, OPT_STR_REGION_PADDING},
     {"align-debug", 0, 0, OPT_ALIGN_DEBUG},
     {"min-read-length", 1, 0, OPT_MIN_READ_LENGTH},
     {"max-read-length", 1, 0, OPT_MAX_READ_LENGTH},
     {"min-flank-allow-mismatch", 1, 0, OPT_MIN_FLANK_ALLOW_MISMATCH},
     {"max-hits-quit-aln", 1, 0, OPT_MAX_HITS_QUIT_ALN},
+    {"no-flank-filter", 0, 0, OPT_NO_FLANK_FILTER},
+    {"anchor-verify", 0, 0, OPT_ANCHOR_VERIFY},
+    {"seeder", 1, 0, OPT_SEEDER},
+    {"seeder-check", 0, 0, OPT_SEEDER_CHECK},
     {"entropy-threshold", 1, 0, OPT_ENTROPY_THRESHOLD},
     {"index-prefix", 1, 0, OPT_INDEX},
     {"nw-score", 1, 0, OPT_SW},
@@ -309,6 +426,28 @@ void parse_commandline_options(int argc, char* argv[]) {
       bam = true;
       AddOption("bampair", "", false, &user_defined_arguments);
       break;
+    case OPT_COLLATE_PAIRS:
+      collate_pairs = true;
+      AddOption("collate-pairs", "", false, &user_defined_arguments);
+      break;
+    case OPT_COLLATE_MAX_PENDING:
+      collate_max_pending = atoi(optarg);
+      if (collate_max_pending <= 0) {
+        PrintMessageDieOnError("Invalid maximum number of pending mates", ERROR);
+      }
+      AddOption("collate-max-pending", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_STR_REGIONS:
+      str_regions = true;
+      AddOption("str-regions", "", false, &user_defined_arguments);
+      break;
+    case OPT_STR_REGION_PADDING:
+      str_region_padding = atoi(optarg);
+      if (str_region_padding < 0) {
+        PrintMessageDieOnError("Invalid STR region padding", ERROR);
+      }
+      AddOption("str-region-padding", string(optarg), true, &user_defined_arguments);
+      break;
     case 'p':
     case OPT_THREADS:
       threads = atoi(optarg);
@@ -317,6 +456,38 @@ void parse_commandline_options(int argc, char* argv[]) {
         PrintMessageDieOnError("Invalid number of threads", ERROR);
       }
       break;
+    case OPT_BATCH_SIZE:
+      if (atoi(optarg) <= 0) {
+        PrintMessageDieOnError("Invalid batch size", ERROR);
+      }
+      batch_size = atoi(optarg);
+      AddOption("batch-size", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_PARSE_THREADS:
+      if (atoi(optarg) < 0) {
+        PrintMessageDieOnError("Invalid number of parse threads", ERROR);
+      }
+      parse_threads = atoi(optarg);
+      AddOption("parse-threads", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_FILE_THREADS:
+      if (atoi(optarg) <= 0) {
+        PrintMessageDieOnError("Invalid number of file threads", ERROR);
+      }
+      file_threads = atoi(optarg);
+      AddOption("file-threads", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_ORDERED_OUTPUT:
+      ordered_output = true;
+      AddOption("ordered-output", "", false, &user_defined_arguments);
+      break;
+    case OPT_REORDER_WINDOW:
+      reorder_window = atoi(optarg);
+      if (reorder_window <= 0) {
+        PrintMessageDieOnError("Invalid reorder window", ERROR);
+      }
+      AddOption("reorder-window", string(optarg), true, &user_defined_arguments);
+      break;
     case OPT_NOWEB: // Deprecated. Always set to true
       noweb = true;
       AddOption("noweb", "", false, &user_defined_arguments);
@@ -336,11 +507,20 @@ void parse_commandline_options(int argc, char* argv[]) {
       paired = true;
       AddOption("files2", string(optarg), true, &user_defined_arguments);
       break;
+    case OPT_INTERLEAVED:
+      interleaved = true;
+      paired = true;
+      AddOption("interleaved", "", false, &user_defined_arguments);
+      break;
     case OPT_GZIP:
       user_defined_arguments += "input_gzipped;";
       gzip = true;
       AddOption("gzip", "", false, &user_defined_arguments);
       break;
+    case OPT_MMAP:
+      use_mmap = true;
+      AddOption("mmap", "", false, &user_defined_arguments);
+      break;
     case 'o':
     case OPT_OUTPUT:
       output_prefix = string(optarg);
@@ -381,6 +561,28 @@ void parse_commandline_options(int argc, char* argv[]) {
       }
       AddOption("maxflank", string(optarg), true, &user_defined_arguments);
       break;
+    case OPT_NO_PRESCREEN:
+      prescreen_reads = false;
+      AddOption("no-prescreen", "", false, &user_defined_arguments);
+      break;
+    case OPT_PRESCREEN_CHECK:
+      prescreen_check = true;
+      AddOption("prescreen-check", "", false, &user_defined_arguments);
+      break;
+    case OPT_DETECTOR:
+      if (string(optarg) == "entropy") {
+        detector_engine = DETECTOR_ENTROPY;
+      } else if (string(optarg) == "autocorrelation") {
+        detector_engine = DETECTOR_AUTOCORRELATION;
+      } else {
+        PrintMessageDieOnError("Invalid detector. Must be entropy or autocorrelation", ERROR);
+      }
+      AddOption("detector", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_DETECTOR_CHECK:
+      detector_check = true;
+      AddOption("detector-check", "", false, &user_defined_arguments);
+      break;
     case OPT_MIN_FLANK_LEN:
       min_flank_len = atoi(optarg);
       if (min_flank_len <= 0) {
@@ -392,6 +594,28 @@ void parse_commandline_options(int argc, char* argv[]) {
       max_hits_quit_aln = atoi(optarg);
       AddOption("max-hits-quit-aln", string(optarg), true, &user_defined_arguments);
       break;
+    case OPT_NO_FLANK_FILTER:
+      use_flank_filter = false;
+      AddOption("no-flank-filter", "", false, &user_defined_arguments);
+      break;
+    case OPT_ANCHOR_VERIFY:
+      anchor_verify = true;
+      AddOption("anchor-verify", "", false, &user_defined_arguments);
+      break;
+    case OPT_SEEDER:
+      if (string(optarg) == "bwt") {
+        seeder_engine = SEEDER_BWT;
+      } else if (string(optarg) == "minimizer") {
+        seeder_engine = SEEDER_MINIMIZER;
+      } else {
+        PrintMessageDieOnError("Invalid seeder. Must be bwt or minimizer", ERROR);
+      }
+      AddOption("seeder", string(optarg), true, &user_defined_arguments);
+      break;
+    case OPT_SEEDER_CHECK:
+      seeder_check = true;
+      AddOption("seeder-check", "", false, &user_defined_arguments);
+      break;
     case OPT_MAX_DIFF_REF:
       max_diff_ref = atoi(optarg);
       if (max_diff_ref <=0 ) {
@@ -481,15 +705,51 @@ void parse_commandline_options(int argc, char* argv[]) {
     PrintMessageDieOnError("min_flank_len must be <= max_flank_len", ERROR);
   }
   // check that we have the mandatory parameters
-  if ((((!paired || bam) && input_files_string.empty()) ||
-       (paired && !bam && (input_files_string_p1.empty() ||
-                           input_files_string_p2.empty())))||
+  if ((((!paired || bam || interleaved) && input_files_string.empty()) ||
+       (paired && !bam && !interleaved &&
+        (input_files_string_p1.empty() ||
+         input_files_string_p2.empty())))||
       output_prefix.empty() || index_prefix.empty()) {
     PrintMessageDieOnError("Required arguments are missing", ERROR);
   }
   if (gzip && bam) {
     PrintMessageDieOnError("Gzip option not compatible with bam input", ERROR);
   }
+  if (interleaved && bam) {
+    PrintMessageDieOnError("--interleaved only applies to fasta/fastq input", ERROR);
+  }
+  if (debug) {
+    // Debug output lists every read that fails detection, so reads
+    // rejected by the pre-screen have to be built as well
+    prescreen_check = true;
+  }
+  if (!prescreen_reads) {
+    prescreen_check = false;
+  }
+  if (str_regions && !bam) {
+    PrintMessageDieOnError("--str-regions only applies to bam input. Ignoring", WARNING);
+    str_regions = false;
+  }
+  if (str_regions && paired) {
+    // Reads come in coordinate order, so mates have to be collated
+    collate_pairs = true;
+  }
+  if (collate_pairs && !(paired && bam)) {
+    PrintMessageDieOnError("--collate-pairs only applies to --bampair input. Ignoring", WARNING);
+    collate_pairs = false;
+  }
+  if (use_mmap && (gzip || bam)) {
+    PrintMessageDieOnError("--mmap only applies to uncompressed fasta/fastq input. Ignoring", WARNING);
+    use_mmap = false;
+  }
+  if (parse_threads > 0 && (gzip || bam)) {
+    PrintMessageDieOnError("--parse-threads only applies to uncompressed fasta/fastq input. Ignoring", WARNING);
+    parse_threads = 0;
+  }
+  if (file_threads > 1 && ordered_output) {
+    PrintMessageDieOnError("--file-threads can't keep the input order of --ordered-output. Reading one file at a time", WARNING);
+    file_threads = 1;
+  }
   if (read_group_sample.empty() || read_group_library.empty()) {
     PrintMessageDieOnError("Must specify --rg-lib and --rg-sample", ERROR);
   }
@@ -528,6 +788,27 @@ void LoadReference() {
   bwt_reference.bwt[0] = bwt_forward;
   bwt_reference.bwt[1] = bwt_reverse;
 
+  // Load the flank k-mer filter. Indexes built without one are
+  // searched as before
+  bwt_reference.flank_filter = NULL;
+  if (use_flank_filter) {
+    if (flank_filter.Load(prefix+".kmf")) {
+      bwt_reference.flank_filter = &flank_filter;
+    } else if (my_verbose) {
+      PrintMessageDieOnError("No k-mer filter in the index, all flanks will be searched", PROGRESS);
+    }
+  }
+
+  // Load the minimizer index, only built on request
+  bwt_reference.minimizer_index = NULL;
+  if (seeder_engine == SEEDER_MINIMIZER || seeder_check) {
+    if (!minimizer_index.Load(prefix+".mzi")) {
+      PrintMessageDieOnError("No minimizer index in " + index_prefix +
+                             ". Build one with lobSTRIndex index -m", ERROR);
+    }
+    bwt_reference.minimizer_index = &minimizer_index;
+  }
+
   // Load BNT annotations
   bntseq_t *bns;
   bns = bns_restore(prefix.c_str());
@@ -597,6 +878,12 @@ void DestroyReference() {
   bns_destroy(bnt_annotation.bns);
 }
 
+// Input files are checked without being opened, so named pipes are
+// left for the reader. "-" is standard input
+static bool InputExists(const string& filename) {
+  return is_stdin(filename) || fexists(filename.c_str());
+}
+
 /*
  * process read in single thread
  */
@@ -615,16 +902,16 @@ void single_thread_process_loop(const vector<string>& files1,
   size_t num_passing_detection = 0;
   for (size_t i = 0; i < files1.size(); i++) {
     file1 = files1.at(i);
-    if (paired && !bam) {
+    if (paired && !bam && !interleaved) {
       file2 = files2.at(i);
       PrintMessageDieOnError("Processing files " + file1 + " and " + file2, PROGRESS);
-      if (!(fexists(file1.c_str()) && fexists(file2.c_str()))) {
+      if (!(InputExists(file1) && InputExists(file2))) {
         PrintMessageDieOnError("File " + file1 + " or " + file2 + " does not exist", WARNING);
         continue;
       }
     } else {
       PrintMessageDieOnError("Processing file " + file1, PROGRESS);
-      if (!fexists(file1.c_str())) {
+      if (!InputExists(file1)) {
         PrintMessageDieOnError("File " + file1 + " does not exist", WARNING);
         continue;
       }
@@ -688,29 +975,53 @@ void single_thread_process_loop(const vector<string>& files1,
     msg << "Processed " << num_reads_processed << ' ' << unit_name;
     PrintMessageDieOnError(msg.str(), PROGRESS);
   }
+  pAligner->AddSearchStats(&run_info);
   delete pDetector;
   delete pAligner;
   run_info.num_processed_units = num_reads_processed;
 }
 
 
+void* input_parser_thread(void *arg) {
+  MultithreadData *pMT_DATA = reinterpret_cast<MultithreadData*>(arg);
+  vector<ReadPair*> free_pairs;
+  while (1) {
+    TextChunk* pChunk = pMT_DATA->get_new_chunk();
+    if (pChunk == NULL) {
+      break;
+    }
+    ReadPairBatch* pBatch = new ReadPairBatch;
+    pBatch->sequence = pChunk->sequence;
+    pBatch->reads.reserve(pChunk->num_records);
+    pMT_DATA->get_free_read_pairs(pChunk->num_records, &free_pairs);
+    ParseTextChunk(*pChunk, &free_pairs, &pBatch->reads);
+    pMT_DATA->recycle_read_pairs(&free_pairs);
+    delete pChunk;
+    // In ordered mode every batch has to reach the writer
+    if (pBatch->reads.empty() && !ordered_output) {
+      delete pBatch;
+      continue;
+    }
+    pMT_DATA->increment_input_counter(pBatch->reads.size());
+    pMT_DATA->post_new_input_batch(pBatch);
+  }
+  return NULL;
+}
+
 void* satellite_process_consumer_thread(void *arg) {
   MultithreadData *pMT_DATA = reinterpret_cast<MultithreadData*>(arg);
   STRDetector *pDetector = new STRDetector();
   BWAReadAligner *pAligner = new BWAReadAligner(&bwt_reference,
                                                 &bnt_annotation,
                                                 &ref_sequences, opts);
-  int aligned = false;
 #ifdef DEBUG_THREADS
   std::stringstream msg;
   msg << "Alignment thread " << pthread_self() << " started" ;
   PrintMessageDieOnError(msg.str(), PROGRESS);
 #endif
   while (1) {
-    aligned = false;
-    std::string repseq;
-    ReadPair* pReadRecord = pMT_DATA->get_new_input();
-    if (pReadRecord == NULL) {
+    ReadPairBatch* pBatch = pMT_DATA->get_new_input();
+    if (pBatch == NULL) {
 #ifdef DEBUG_THREADS
       std::stringstream msg;
       msg << "Alignment thread " << pthread_self() << " completed" ;
@@ -718,50 +1029,70 @@ void* satellite_process_consumer_thread(void *arg) {
 #endif
       break;
     }
-    if (!(pReadRecord->reads.at(0).nucleotides.length() >= min_read_length)
-        && (pReadRecord->reads.at(0).nucleotides.length() <= max_read_length)) {
-      delete pReadRecord;
-      pMT_DATA->increment_output_counter();
-      continue;
-    }
-    if (pReadRecord->reads.at(0).paired) {
-      if (!(pReadRecord->reads.at(1).nucleotides.length() >= min_read_length) &&
-          (pReadRecord->reads.at(1).nucleotides.length() <= max_read_length)) {
-        delete pReadRecord;
-        pMT_DATA->increment_output_counter();
+    // Aligned reads are passed on to the writer thread in one batch,
+    // everything else is discarded here
+    ReadPairBatch* pOutput = new ReadPairBatch;
+    pOutput->sequence = pBatch->sequence;
+    pOutput->reads.reserve(pBatch->reads.size());
+    // Reads that did not align go straight back to the pool
+    vector<ReadPair*> discarded;
+    for (vector<ReadPair*>::iterator it = pBatch->reads.begin();
+         it != pBatch->reads.end(); ++it) {
+      ReadPair* pReadRecord = *it;
+      if (!(pReadRecord->reads.at(0).nucleotides.length() >= min_read_length)
+          && (pReadRecord->reads.at(0).nucleotides.length() <= max_read_length)) {
+        discarded.push_back(pReadRecord);
         continue;
       }
-    }
-    bases += pReadRecord->reads.at(0).nucleotides.length();
-    if (pReadRecord->reads.at(0).paired) bases += pReadRecord->reads.at(1).nucleotides.length();
-
-    // STEP 1: Sensing
-    string err, messages;
-    if (!pDetector->ProcessReadPair(pReadRecord, &err, &messages)) {
-      pMT_DATA->increment_output_counter();
-      delete pReadRecord;
-      continue;
-    }
+      if (pReadRecord->reads.at(0).paired) {
+        if (!(pReadRecord->reads.at(1).nucleotides.length() >= min_read_length) &&
+            (pReadRecord->reads.at(1).nucleotides.length() <= max_read_length)) {
+          discarded.push_back(pReadRecord);
+          continue;
+        }
+      }
+      bases += pReadRecord->reads.at(0).nucleotides.length();
+      if (pReadRecord->reads.at(0).paired) bases += pReadRecord->reads.at(1).nucleotides.length();
 
-    // STEP 2: Alignment
-    if (pAligner->ProcessReadPair(pReadRecord, &err, &messages)) {
-      aligned = true;
+      // STEP 1: Sensing
+      string err, messages;
+      if (!pDetector->ProcessReadPair(pReadRecord, &err, &messages)) {
+        discarded.push_back(pReadRecord);
+        continue;
+      }
+
+      // STEP 2: Alignment
+      if (pAligner->ProcessReadPair(pReadRecord, &err, &messages)) {
+        pOutput->reads.push_back(pReadRecord);
+      } else {
+        discarded.push_back(pReadRecord);
+      }
+    }
+    delete pBatch;
+    if (!discarded.empty()) {
+      pMT_DATA->increment_output_counter(discarded.size());
+      pMT_DATA->recycle_read_pairs(&discarded);
     }
-    if (aligned) {
-      pMT_DATA->post_new_output_read(pReadRecord);
+    if (pOutput->reads.empty() && !ordered_output) {
+      delete pOutput;
     } else {
-      // Don't pass this read on to the output thread,
-      // discard it here
-      delete pReadRecord;
-      pMT_DATA->increment_output_counter();
+      pMT_DATA->post_new_output_batch(pOutput);
     }
   }
+  pthread_mutex_lock(&run_info_mutex);
+  pAligner->AddSearchStats(&run_info);
+  pthread_mutex_unlock(&run_info_mutex);
+  delete pDetector;
+  delete pAligner;
   return NULL;
 }
 
 void* output_writer_thread(void *arg) {
   MultithreadData *pMT_DATA = reinterpret_cast<MultithreadData*>(arg);
   SamFileWriter samWriter(output_prefix + ".aligned.bam", chrom_sizes);
+  // Batches that arrived ahead of their turn (ordered output only)
+  map<size_t, ReadPairBatch*> pending_batches;
+  size_t next_sequence = 0;
 #ifdef DEBUG_THREADS
   std::stringstream msg;
   msg << "Writer thread " << pthread_self() << " started (output file ='"
@@ -769,8 +1100,8 @@ void* output_writer_thread(void *arg) {
   PrintMessageDieOnError(msg.str(),PROGRESS);
 #endif
   while (1) {
-    ReadPair *pReadRecord = pMT_DATA->get_new_output();
-    if (pReadRecord == NULL) {
+    ReadPairBatch *pBatch = pMT_DATA->get_new_output();
+    if (pBatch == NULL) {
 #ifdef DEBUG_THREADS
       std::stringstream msg;
       msg << "Writer thread " << pthread_self() << " completed";
@@ -778,19 +1109,222 @@ void* output_writer_thread(void *arg) {
 #endif
       break;
     }
-    samWriter.WriteRecord(*pReadRecord);
-    delete pReadRecord;
-    pMT_DATA->increment_output_counter();
+    if (ordered_output) {
+      pending_batches[pBatch->sequence] = pBatch;
+      if (pBatch->sequence != next_sequence) {
+        continue;
+      }
+    }
+    while (pBatch != NULL) {
+      for (vector<ReadPair*>::iterator it = pBatch->reads.begin();
+           it != pBatch->reads.end(); ++it) {
+        samWriter.WriteRecord(**it);
+      }
+      pMT_DATA->increment_output_counter(pBatch->reads.size());
+      pMT_DATA->recycle_read_pairs(&pBatch->reads);
+      delete pBatch;
+      pBatch = NULL;
+      if (ordered_output) {
+        // Let the reader hand out one more batch
+        pending_batches.erase(next_sequence);
+        pMT_DATA->release_output_window();
+        next_sequence++;
+        if (!pending_batches.empty() &&
+            pending_batches.begin()->first == next_sequence) {
+          pBatch = pending_batches.begin()->second;
+        }
+      }
+    }
+  }
+  if (!pending_batches.empty()) {
+    PrintMessageDieOnError("Internal error: batches left in the reorder window", ERROR);
   }
   return NULL;
 }
 
+// Input files shared by the threads reading them (--file-threads).
+// Each reading thread takes the next file nobody has started yet
+struct InputFiles {
+  InputFiles(const vector<string>& _files1, const vector<string>& _files2,
+             MultithreadData* _mtdata)
+    : files1(_files1), files2(_files2), mtdata(_mtdata),
+      next_file(0), num_reads(0), batch_sequence(0) {
+    pthread_mutex_init(&mutex, NULL);
+  }
+  ~InputFiles() {
+    pthread_mutex_destroy(&mutex);
+  }
+  const vector<string>& files1;
+  const vector<string>& files2;
+  MultithreadData* mtdata;
+  pthread_mutex_t mutex;
+  size_t next_file;
+  // Reads read from all files so far
+  size_t num_reads;
+  size_t batch_sequence;
+  // Readers of mapped files, kept until the input parsing threads are done
+  list<TextChunkReader*> finished_chunk_readers;
+};
+
+/* Get the next input file (pair) nobody has started yet. Return false when there are none left */
+static bool GetNextInputFile(InputFiles* input, string* file1, string* file2) {
+  pthread_mutex_lock(&input->mutex);
+  bool found = false;
+  while (!found && input->next_file < input->files1.size()) {
+    size_t i = input->next_file++;
+    *file1 = input->files1.at(i);
+    if (paired && !bam && !interleaved) {
+      *file2 = input->files2.at(i);
+      PrintMessageDieOnError("Processing files " + *file1 + " and " + *file2, PROGRESS);
+      if (!(InputExists(*file1) && InputExists(*file2))) {
+        PrintMessageDieOnError("File " + *file1 + " or " + *file2 + " does not exist", WARNING);
+        continue;
+      }
+    } else {
+      PrintMessageDieOnError("Processing file " + *file1, PROGRESS);
+      if (!InputExists(*file1)) {
+        PrintMessageDieOnError("File " + *file1 + " does not exist", WARNING);
+        continue;
+      }
+    }
+    found = true;
+  }
+  pthread_mutex_unlock(&input->mutex);
+  return found;
+}
+
+/* Number the next batch or chunk of reads, once there is room for it */
+static size_t NextBatchSequence(InputFiles* input) {
+  if (ordered_output) {
+    input->mtdata->wait_for_output_window();
+  }
+  pthread_mutex_lock(&input->mutex);
+  size_t sequence = input->batch_sequence++;
+  pthread_mutex_unlock(&input->mutex);
+  return sequence;
+}
+
+/* Add reads handed to the alignment threads to the total, report progress */
+static void CountInputReads(InputFiles* input, size_t num_reads) {
+  pthread_mutex_lock(&input->mutex);
+  size_t previous = input->num_reads;
+  input->num_reads += num_reads;
+  if (previous/READPROGRESS != input->num_reads/READPROGRESS) {
+    stringstream msg;
+    msg << "Processed " << (input->num_reads/READPROGRESS)*READPROGRESS
+        << " " << unit_name;
+    PrintMessageDieOnError(msg.str(), PROGRESS);
+  }
+  pthread_mutex_unlock(&input->mutex);
+}
+
+/* Hand a batch of reads to the alignment threads */
+static void PostInputBatch(InputFiles* input, ReadPairBatch* pBatch) {
+  pBatch->sequence = NextBatchSequence(input);
+  input->mtdata->increment_input_counter(pBatch->reads.size());
+  input->mtdata->post_new_input_batch(pBatch);
+  CountInputReads(input, pBatch->reads.size());
+}
+
+/* Read input files until none are left, feeding the alignment threads */
+void read_input_files(InputFiles* input) {
+  MultithreadData* mtdata = input->mtdata;
+  // Numbers the reads read by this thread
+  size_t counter = 1;
+  std::string file1;
+  std::string file2;
+  ReadPairBatch *pBatch = new ReadPairBatch;
+  pBatch->reads.reserve(batch_size);
+  // ReadPair objects taken from the pool, not yet filled
+  vector<ReadPair*> free_pairs;
+  while (GetNextInputFile(input, &file1, &file2)) {
+    size_t file_start = counter;
+    if (parse_threads > 0) {
+      // Only cut the input into chunks of whole records here,
+      // parsing happens in the input parsing threads
+      TextChunkReader *chunk_reader = new TextChunkReader(file1, file2,
+                                                          counter);
+      TextChunk *pChunk = new TextChunk;
+      while (chunk_reader->GetNextChunk(pChunk, batch_size)) {
+        size_t num_reads = chunk_reader->GetNextReadCount() - counter;
+        counter = chunk_reader->GetNextReadCount();
+        pChunk->sequence = NextBatchSequence(input);
+        mtdata->post_new_chunk(pChunk);
+        CountInputReads(input, num_reads);
+        pChunk = new TextChunk;
+      }
+      delete pChunk;
+      counter = chunk_reader->GetNextReadCount();
+      if (use_mmap) {
+        // Chunks of a mapped file point into the mapping. Keep it
+        // until the input parsing threads are done
+        pthread_mutex_lock(&input->mutex);
+        input->finished_chunk_readers.push_back(chunk_reader);
+        pthread_mutex_unlock(&input->mutex);
+      } else {
+        delete chunk_reader;
+      }
+    } else {
+      IFileReader *pReader = create_file_reader(file1, file2);
+      do {
+        if (free_pairs.empty()) {
+          mtdata->get_free_read_pairs(batch_size, &free_pairs);
+        }
+        ReadPair *pRecord = free_pairs.back();
+        free_pairs.pop_back();
+        pRecord->read_count = counter;
+        if (!pReader->GetNextRecord(pRecord)) {
+          free_pairs.push_back(pRecord);
+          break;  // no more reads
+        }
+        counter++;
+        pBatch->reads.push_back(pRecord);
+        if (pBatch->reads.size() == batch_size) {
+          PostInputBatch(input, pBatch);
+          // the consumers will take it from here, and recycle it
+          pBatch = new ReadPairBatch;
+          pBatch->reads.reserve(batch_size);
+        }
+      } while (1);
+      delete pReader;
+    }
+    stringstream msg;
+    msg << "Finished file " << file1 << ": " << counter - file_start
+        << " " << unit_name;
+    PrintMessageDieOnError(msg.str(), PROGRESS);
+  }
+  // Hand off the last partial batch
+  if (!pBatch->reads.empty()) {
+    PostInputBatch(input, pBatch);
+  } else {
+    delete pBatch;
+  }
+  pBatch = NULL;
+  mtdata->recycle_read_pairs(&free_pairs);
+}
+
+void* input_file_reader_thread(void *arg) {
+  InputFiles* input = reinterpret_cast<InputFiles*>(arg);
+  read_input_files(input);
+  return NULL;
+}
+
 void multi_thread_process_loop(vector<string> files1,
                                vector<string> files2) {
-  MultithreadData mtdata(threads);
+  // Allow the reader to stay one batch ahead of each alignment thread
+  MultithreadData mtdata(2*threads, 2*parse_threads+1, reorder_window);
   list<pthread_t> satellite_threads;
+  list<pthread_t> parser_threads;
   pthread_t writer_thread;
   if (files1.size() == 0) return;
+  for (size_t i = 0; i < parse_threads; ++i) {
+    pthread_t id;
+    if (pthread_create(&id, NULL, input_parser_thread,
+                       reinterpret_cast<void*>(&mtdata))) {
+      PrintMessageDieOnError("Failed to create input parsing threads", ERROR);
+    }
+    parser_threads.push_back(id);
+  }
   for (size_t i = 0; i < threads; ++i) {
     pthread_t id;
     if (pthread_create(&id, NULL, satellite_process_consumer_thread,
@@ -805,51 +1339,60 @@ void multi_thread_process_loop(vector<string> files1,
     PrintMessageDieOnError("Failed to create output writer threads", ERROR);
   }
 
-  size_t counter = 1;
-  std::string file1;
-  std::string file2;
-  for (size_t i = 0; i < files1.size(); i++) {
-    file1 = files1.at(i);
-    if (paired && !bam) {
-      file2 = files2.at(i);
-      PrintMessageDieOnError("Processing files " + file1 + " and " + file2, PROGRESS);
-      if (!(fexists(file1.c_str()) && fexists(file2.c_str()))) {
-        PrintMessageDieOnError("File " + file1 + " or " + file2 + " does not exist", WARNING);
-        continue;
-      }
-    } else {
-      PrintMessageDieOnError("Processing file " + file1, PROGRESS);
-      if (!fexists(file1.c_str())) {
-        PrintMessageDieOnError("File " + file1 + " or " + file2 + " does not exist", WARNING);
-        continue;
+  // Several files are read at once by independent reading threads.
+  // With a single one, the files are read here in order
+  InputFiles input(files1, files2, &mtdata);
+  size_t num_readers = std::min(file_threads, files1.size());
+  if (num_readers > 1) {
+    list<pthread_t> reader_threads;
+    for (size_t i = 0; i < num_readers; ++i) {
+      pthread_t id;
+      if (pthread_create(&id, NULL, input_file_reader_thread,
+                         reinterpret_cast<void*>(&input))) {
+        PrintMessageDieOnError("Failed to create input reading threads", ERROR);
       }
+      reader_threads.push_back(id);
     }
-    IFileReader *pReader = create_file_reader(file1, file2);
-    do {
-      ReadPair *pRecord = new ReadPair;
-      pRecord->read_count = counter;
-      if (counter % READPROGRESS == 0) {
+    for (list<pthread_t>::const_iterator it = reader_threads.begin();
+         it != reader_threads.end(); ++it) {
+      int i = pthread_join(*it,NULL);
+      if (i != 0) {
         stringstream msg;
-        msg << "Processed " << counter << " " << unit_name;
-        PrintMessageDieOnError(msg.str(), PROGRESS);
-      }
-      if (!pReader->GetNextRecord(pRecord))
-        break;  // no more reads
-      counter++;
-      mtdata.increment_input_counter();
-      mtdata.post_new_input_read(pRecord);
-      pRecord = NULL;  // the consumers will take it from here, and free it
-    } while (1);
-    delete pReader;
+        msg << "Failed to join input reading thread " << (*it) <<
+               "error code = " << i ;
+        PrintMessageDieOnError(msg.str(), WARNING);
+      }
+    }
+  } else {
+    read_input_files(&input);
+  }
+  run_info.num_processed_units = input.num_reads + 1;
+
+  //Send a 'poison pill' to the input parsing threads
+  for (size_t i = 0; i < parse_threads; ++i)
+    mtdata.post_new_chunk(NULL);
+
+  for (list<pthread_t>::const_iterator it = parser_threads.begin();
+          it != parser_threads.end(); ++it) {
+    int i = pthread_join(*it,NULL);
+    if (i != 0) {
+       stringstream msg;
+       msg << "Failed to join input parsing thread " << (*it) <<
+              "error code = " << i ;
+       PrintMessageDieOnError(msg.str(), WARNING);
+    }
+  }
+  for (list<TextChunkReader*>::iterator it = input.finished_chunk_readers.begin();
+       it != input.finished_chunk_readers.end(); ++it) {
+    delete *it;
   }
-  run_info.num_processed_units = counter;
 
 #ifdef DEBUG_THREADS
   PrintMessageDieOnError("No more input, waiting for alignment threads completion", PROGRESS);
 #endif
   //Send a 'poison pill' to the alignment threads
   for (size_t i = 0; i < threads; ++i)
-    mtdata.post_new_input_read(NULL);
+    mtdata.post_new_input_batch(NULL);
 
   for (list<pthread_t>::const_iterator it = satellite_threads.begin();
           it != satellite_threads.end(); ++it) {
@@ -865,7 +1408,7 @@ void multi_thread_process_loop(vector<string> files1,
 #ifdef DEBUG_THREADS
   PrintMessageDieOnError("waiting for writer thread completion", PROGRESS);
 #endif
-  mtdata.post_new_output_read(NULL);
+  mtdata.post_new_output_batch(NULL);
   int i = pthread_join(writer_thread,NULL);
   if (i != 0) {
     stringstream msg;
@@ -921,7 +1464,7 @@ int main(int argc, char* argv[]) {
   opts->max_hits_quit_aln = max_hits_quit_aln;
 
   // get the input files
-  if (paired && !bam) {
+  if (paired && !bam && !interleaved) {
     boost::split(input_files1, input_files_string_p1, boost::is_any_of(","));
     boost::split(input_files2, input_files_string_p2, boost::is_any_of(","));
     if (input_files1.size() != input_files2.size()) {
@@ -934,20 +1477,29 @@ int main(int argc, char* argv[]) {
   // run detection/alignment
   PrintMessageDieOnError("Running detection/alignment...", PROGRESS);
   time(&processing_starttime);
-  if (threads == 1) {
-    if (paired && !bam) {
+  if (threads == 1 && parse_threads == 0 && file_threads == 1) {
+    if (paired && !bam && !interleaved) {
       single_thread_process_loop(input_files1, input_files2);
     } else {
       single_thread_process_loop(input_files, vector<string>(0));
     }
   } else {
-    if (paired && !bam) {
+    if (paired && !bam && !interleaved) {
       multi_thread_process_loop(input_files1, input_files2);
     } else {
       multi_thread_process_loop(input_files, vector<string>(0));
     }
   }
   time(&endtime);
+  if (prescreen_check) {
+    PrintPrescreenCheckSummary();
+  }
+  if (detector_check) {
+    PrintDetectorCheckSummary();
+  }
+  if (seeder_check) {
+    PrintSeederCheckSummary();
+  }
   run_info.endtime = GetTime();
   DestroyReference();
   OutputRunStatistics();
@@ -0,0 +1,186 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bntseq.h"
+#include "mzindex.h"
+#include "utils.h"
+
+/* No k-mer in this window position: broken by an N, or a palindrome */
+#define MZ_NONE (~0ULL)
+
+typedef struct {
+	uint32_t hash;
+	uint64_t pos;
+} mz_entry_t;
+
+static int mz_entry_cmp(const void *a, const void *b)
+{
+	const mz_entry_t *x = (const mz_entry_t*)a, *y = (const mz_entry_t*)b;
+	if (x->hash != y->hash) return x->hash < y->hash? -1 : 1;
+	if (x->pos != y->pos) return x->pos < y->pos? -1 : 1;
+	return 0;
+}
+
+/* Append the k-mers with the smallest hash in a window of count
+   k-mers, oldest at window[first], that are not in out yet. All tied
+   k-mers go in, so a sequence and its reverse complement have the
+   same minimizers */
+static int mz_push_min(const uint64_t *window, int count, int first, int w, mz_t *out, int n)
+{
+	uint64_t min = MZ_NONE;
+	int t;
+	for (t = 0; t < count; ++t)
+		if (window[t] >> 32 < min >> 32) min = window[t];
+	if (min == MZ_NONE) return n;
+	// oldest first, so out stays sorted by position
+	for (t = 0; t < count; ++t) {
+		uint64_t v = window[(first + t) % w];
+		if (v >> 32 != min >> 32 || v == MZ_NONE) continue;
+		if (n > 0 && out[n-1].pos >> 1 >= (uint32_t)v >> 1) continue;
+		out[n].hash = (uint32_t)(v >> 32);
+		out[n].pos = (uint32_t)v;
+		++n;
+	}
+	return n;
+}
+
+int mz_sketch(const uint8_t *seq, int len, int k, int w, mz_t *out)
+{
+	uint64_t mask = (1ULL << (k << 1)) - 1, fwd = 0, rev = 0;
+	uint64_t window[MZ_INDEX_MAX_W];
+	int shift = (k - 1) << 1, run = 0, n = 0, n_kmers = 0, i;
+
+	for (i = 0; i < len; ++i) {
+		uint64_t c = seq[i], v = MZ_NONE;
+		if (c < 4) {
+			fwd = (fwd << 2 | c) & mask;
+			rev = rev >> 2 | (3 - c) << shift;
+			// palindromes hash the same on both strands, so have no strand
+			if (++run >= k && fwd != rev) {
+				int strand = rev < fwd;
+				v = (uint64_t)mz_hash(strand? rev : fwd, mask) << 32
+					| (uint32_t)((i - k + 1) << 1 | strand);
+			}
+		} else run = 0;
+		if (i < k - 1) continue;
+		window[n_kmers++ % w] = v;
+		if (n_kmers >= w) n = mz_push_min(window, w, n_kmers % w, w, out, n);
+	}
+	if (n_kmers > 0 && n_kmers < w) n = mz_push_min(window, n_kmers, 0, w, out, n);
+	return n;
+}
+
+void mz_index_build(const char *prefix, int k, int w)
+{
+	bntseq_t *bns;
+	char *name;
+	FILE *fp;
+	uint8_t *pac, *seq;
+	mz_t *mzs;
+	mz_entry_t *entries = 0;
+	int64_t l_pac, pac_size, n_entries = 0, m_entries = 0, i, j, h = 0;
+	uint64_t *buckets, n_buckets;
+	uint32_t *hashes;
+	int32_t max_len = 0, bucket_bits = 1, hash_bits = k << 1;
+	mz_index_header_t header;
+
+	xassert(k > 0 && k <= MZ_INDEX_MAX_K, "minimizer k-mer size out of range.");
+	xassert(w > 0 && w <= MZ_INDEX_MAX_W, "minimizer window out of range.");
+	bns = bns_restore(prefix);
+	l_pac = bns->l_pac;
+	name = (char*)calloc(strlen(prefix) + 10, 1);
+	strcpy(name, prefix); strcat(name, ".pac");
+	fp = xopen(name, "rb");
+	pac_size = l_pac / 4 + 1;
+	pac = (uint8_t*)calloc(pac_size, 1);
+	xassert(fread(pac, 1, pac_size, fp) == (size_t)pac_size, "truncated .pac file.");
+	fclose(fp);
+
+	for (i = 0; i < bns->n_seqs; ++i)
+		if (bns->anns[i].len > max_len) max_len = bns->anns[i].len;
+	seq = (uint8_t*)calloc(max_len + 1, 1);
+	mzs = (mz_t*)calloc(max_len + 1, sizeof(mz_t));
+	// each reference sequence on its own, so no minimizer spans two
+	for (i = 0; i < bns->n_seqs; ++i) {
+		const bntann1_t *ann = bns->anns + i;
+		int n;
+		for (j = 0; j < ann->len; ++j) {
+			int64_t p = ann->offset + j;
+			seq[j] = pac[p >> 2] >> ((~p & 3) << 1) & 3;
+		}
+		// the .pac holds random bases in place of Ns, leave them out
+		for (; h < bns->n_holes && bns->ambs[h].offset < ann->offset + ann->len; ++h) {
+			int64_t start = bns->ambs[h].offset, end = start + bns->ambs[h].len;
+			if (start < ann->offset) start = ann->offset;
+			if (end > ann->offset + ann->len) end = ann->offset + ann->len;
+			for (j = start; j < end; ++j) seq[j - ann->offset] = 4;
+			if (bns->ambs[h].offset + bns->ambs[h].len > ann->offset + ann->len) break;
+		}
+		n = mz_sketch(seq, ann->len, k, w, mzs);
+		if (n_entries + n > m_entries) {
+			m_entries = (n_entries + n) << 1;
+			entries = (mz_entry_t*)realloc(entries, m_entries * sizeof(mz_entry_t));
+			xassert(entries, "not enough memory for the minimizer index.");
+		}
+		for (j = 0; j < n; ++j) {
+			entries[n_entries].hash = mzs[j].hash;
+			entries[n_entries++].pos = (uint64_t)i << 32 | mzs[j].pos;
+		}
+	}
+	free(mzs); free(seq); free(pac);
+	bns_destroy(bns);
+	qsort(entries, n_entries, sizeof(mz_entry_t), mz_entry_cmp);
+
+	// a few entries per bucket
+	while (bucket_bits < hash_bits && (1LL << bucket_bits) < n_entries / 4) ++bucket_bits;
+	n_buckets = 1ULL << bucket_bits;
+	buckets = (uint64_t*)calloc(n_buckets + 1, sizeof(uint64_t));
+	hashes = (uint32_t*)calloc(n_entries + 1, sizeof(uint32_t));
+	for (i = 0; i < n_entries; ++i) {
+		++buckets[(entries[i].hash >> (hash_bits - bucket_bits)) + 1];
+		hashes[i] = entries[i].hash;
+	}
+	for (i = 0; i < (int64_t)n_buckets; ++i) buckets[i + 1] += buckets[i];
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MZ_INDEX_MAGIC, sizeof(header.magic));
+	header.version = MZ_INDEX_VERSION;
+	header.k = k;
+	header.w = w;
+	header.bucket_bits = bucket_bits;
+	header.num_entries = n_entries;
+	strcpy(name, prefix); strcat(name, ".mzi");
+	fp = xopen(name, "wb");
+	xassert(fwrite(&header, sizeof(header), 1, fp) == 1, "failed to write the minimizer index.");
+	xassert(fwrite(buckets, sizeof(uint64_t), n_buckets + 1, fp) == n_buckets + 1,
+			"failed to write the minimizer index.");
+	// hashes are padded to 8 bytes, so the positions stay aligned
+	xassert(fwrite(hashes, sizeof(uint32_t), (n_entries + 1) & ~1LL, fp) == (size_t)((n_entries + 1) & ~1LL),
+			"failed to write the minimizer index.");
+	for (i = 0; i < n_entries; ++i)
+		xassert(fwrite(&entries[i].pos, sizeof(uint64_t), 1, fp) == 1, "failed to write the minimizer index.");
+	fclose(fp);
+	free(hashes); free(buckets); free(entries);
+	free(name);
+}
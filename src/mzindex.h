@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_MZINDEX_H__
+#define SRC_MZINDEX_H__
+
+#include <stdint.h>
+
+/*
+  Hash index of the minimizers of the indexed reference, an
+  alternative to the BWT for seeding flank alignments. lobSTRIndex
+  writes it next to the BWT files as <prefix>.mzi when asked to with
+  -m, lobSTR uses it with --seeder minimizer.
+
+  A minimizer is the k-mer with the smallest hash among w consecutive
+  k-mers, on either strand. Any exact match of at least w+k-1 bases
+  between a read and the reference shares a minimizer.
+
+  File layout: a mz_index_header_t, then 2^bucket_bits+1 uint64_t
+  bucket starts, num_entries uint32_t hashes (padded to 8 bytes) and
+  num_entries uint64_t positions. Entries are sorted by hash, and the
+  top bucket_bits of a hash give its bucket. A position packs the
+  reference sequence, the offset of the k-mer in it and whether the
+  reverse complement k-mer was hashed:
+  seqid << 32 | offset << 1 | strand.
+ */
+
+#define MZ_INDEX_MAGIC "LOBSTRMZ"
+#define MZ_INDEX_VERSION 1
+#define MZ_INDEX_DEFAULT_K 15
+#define MZ_INDEX_MAX_K 16
+#define MZ_INDEX_DEFAULT_W 5
+#define MZ_INDEX_MAX_W 32
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t k;
+	uint32_t w;
+	uint32_t bucket_bits;
+	uint64_t num_entries;
+} mz_index_header_t;
+
+/* A minimizer of a sequence: its hash, and offset << 1 | strand */
+typedef struct {
+	uint32_t hash;
+	uint32_t pos;
+} mz_t;
+
+/* Invertible hash of a k-mer of 2k bits (Thomas Wang's integer hash) */
+static inline uint32_t mz_hash(uint64_t key, uint64_t mask)
+{
+	key = (~key + (key << 21)) & mask;
+	key = key ^ key >> 24;
+	key = ((key + (key << 3)) + (key << 8)) & mask;
+	key = key ^ key >> 14;
+	key = ((key + (key << 2)) + (key << 4)) & mask;
+	key = key ^ key >> 28;
+	key = (key + (key << 31)) & mask;
+	return (uint32_t)key;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/* Minimizers of seq[0, len) by position, 2 bit codes with anything
+	   above 3 breaking k-mers. Ties for the smallest hash in a window
+	   are all minimizers, and a sequence shorter than a window gets its
+	   smallest k-mers. out needs room for len entries, returns the
+	   number written */
+	int mz_sketch(const uint8_t *seq, int len, int k, int w, mz_t *out);
+
+	/* Build <prefix>.mzi from <prefix>.pac and <prefix>.ann */
+	void mz_index_build(const char *prefix, int k, int w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SRC_MZINDEX_H__ */
@@ -43,13 +43,28 @@ bool quiet = false;
 
 // threading
 size_t threads = 1;
+size_t batch_size = 1024;
+size_t parse_threads = 0;
+size_t file_threads = 1;
+bool ordered_output = false;
+int reorder_window = 32;
 
 // input files
 std::string input_files_string = "";
 std::string input_files_string_p1 = "";
 std::string input_files_string_p2 = "";
 INPUT_TYPE input_type = INPUT_FASTA;
+bool use_mmap = false;
+bool prescreen_reads = true;
+bool prescreen_check = false;
+DETECTOR_ENGINE detector_engine = DETECTOR_ENTROPY;
+bool detector_check = false;
+bool collate_pairs = false;
+int collate_max_pending = 1000000;
+bool str_regions = false;
+int str_region_padding = 1000;
 bool paired = false;
+bool interleaved = false;
 bool gzip = false;
 
 // output files
@@ -75,6 +90,10 @@ int max_diff_ref = 50;
 bool unit = false;
 int extend = 1000;
 int min_length_to_allow_mismatches = 30;
+bool use_flank_filter = true;
+bool anchor_verify = false;
+SEEDER_ENGINE seeder_engine = SEEDER_BWT;
+bool seeder_check = false;
 int max_hits_quit_aln = 1000;
 bool allow_one_flank_align = true;
 std::string index_prefix = "";
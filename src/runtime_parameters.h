@@ -51,6 +51,16 @@ enum INPUT_TYPE {
   INPUT_BAM
 };
 
+enum DETECTOR_ENGINE {
+  DETECTOR_ENTROPY = 0,
+  DETECTOR_AUTOCORRELATION
+};
+
+enum SEEDER_ENGINE {
+  SEEDER_BWT = 0,
+  SEEDER_MINIMIZER
+};
+
 enum PROGRAM {
   LOBSTR = 0,
   ALLELOTYPE
@@ -67,13 +77,28 @@ extern bool quiet;
 
 // threading
 extern size_t threads;
+extern size_t batch_size;
+extern size_t parse_threads;
+extern size_t file_threads;
+extern bool ordered_output;
+extern int reorder_window;
 
 // input files
 extern std::string input_files_string;
 extern std::string input_files_string_p1;
 extern std::string input_files_string_p2;
 extern INPUT_TYPE input_type;
+extern bool use_mmap;
+extern bool prescreen_reads;
+extern bool prescreen_check;
+extern DETECTOR_ENGINE detector_engine;
+extern bool detector_check;
+extern bool collate_pairs;
+extern int collate_max_pending;
+extern bool str_regions;
+extern int str_region_padding;
 extern bool paired;
+extern bool interleaved;
 extern bool gzip;
 
 // output files
@@ -99,6 +124,10 @@ extern int max_diff_ref;
 extern bool unit;
 extern int extend;
 extern int min_length_to_allow_mismatches;
+extern bool use_flank_filter;
+extern bool anchor_verify;
+extern SEEDER_ENGINE seeder_engine;
+extern bool seeder_check;
 extern int max_hits_quit_aln;
 extern bool allow_one_flank_align;
 extern std::string index_prefix;
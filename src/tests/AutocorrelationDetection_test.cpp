@@ -0,0 +1,75 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string>
+
+#include "src/tests/AutocorrelationDetection_test.h"
+#include "src/AutocorrelationDetection.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AutocorrelationDetectionTest);
+
+void AutocorrelationDetectionTest::setUp() {}
+void AutocorrelationDetectionTest::tearDown() {}
+
+// Flanks without any stretch of period 1-6 long enough to be reported
+static const string LEFT_FLANK = "GATTCAGCTAGGCATCTGAACGTTGCACCTGAGTCATG";
+static const string RIGHT_FLANK = "CTGTAGACATTGCGAACCTGTTAGGCATCGACTCGTTG";
+
+void AutocorrelationDetectionTest::test_PerfectRepeats() {
+  const char* units[] = {"T", "CA", "AGC", "GATA", "AAAGG", "AACCTG"};
+  for (size_t k = 0; k < 6; k++) {
+    string repeat;
+    while (repeat.size() < 36) repeat += units[k];
+    DetectedRepeat detected;
+    CPPUNIT_ASSERT(DetectRepeatByAutocorrelation(LEFT_FLANK + repeat + RIGHT_FLANK,
+                                                 &detected));
+    CPPUNIT_ASSERT_EQUAL(k+1, detected.period);
+    // The repeat may run on by the bases the flanks happen to share
+    // with it, and the motif starts where the repeat starts
+    CPPUNIT_ASSERT((string(units[k]) + units[k]).find(detected.motif) !=
+                   string::npos);
+    CPPUNIT_ASSERT(detected.start <= LEFT_FLANK.size() &&
+                   detected.start + 3 >= LEFT_FLANK.size());
+    size_t repeat_end = LEFT_FLANK.size() + repeat.size() - 1;
+    CPPUNIT_ASSERT(detected.end >= repeat_end && detected.end <= repeat_end + 3);
+  }
+}
+
+void AutocorrelationDetectionTest::test_InterruptedRepeat() {
+  // A single mismatch does not split the repeat in two
+  string repeat = "CACACACACACACACACATACACACACACACACACA";
+  DetectedRepeat detected;
+  CPPUNIT_ASSERT(DetectRepeatByAutocorrelation(LEFT_FLANK + repeat + RIGHT_FLANK,
+                                               &detected));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), detected.period);
+  CPPUNIT_ASSERT(detected.start <= LEFT_FLANK.size());
+  CPPUNIT_ASSERT(detected.end >= LEFT_FLANK.size() + repeat.size() - 1);
+}
+
+void AutocorrelationDetectionTest::test_NoRepeat() {
+  DetectedRepeat detected;
+  CPPUNIT_ASSERT(!DetectRepeatByAutocorrelation(LEFT_FLANK + RIGHT_FLANK,
+                                                &detected));
+  // Runs of Ns are not repeats
+  CPPUNIT_ASSERT(!DetectRepeatByAutocorrelation(LEFT_FLANK + string(30, 'N') +
+                                                RIGHT_FLANK, &detected));
+}
@@ -0,0 +1,263 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/tests/BWAReadAligner_test.h"
+#include "src/BWAReadAligner.h"
+#include "src/bntseq.h"
+#include "src/common.h"
+#include "src/mzindex.h"
+#include "src/runtime_parameters.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BWAReadAlignerTest);
+
+// Locus the flank is taken from, where in it and how long it is
+const int FLANK_LOCUS = 1;
+const int FLANK_OFFSET = 3000;
+const int FLANK_LENGTH = 80;
+// Where a copy of the flank is put in the same locus
+const int COPY_OFFSET = 4500;
+
+// Gives the tests the flank searches of the aligner
+class SeedingAligner : public BWAReadAligner {
+ public:
+  SeedingAligner(BWT* bwt_reference, BNT* bnt_annotation,
+                 map<int, REFSEQ>* ref_sequences, gap_opt_t* opts)
+    : BWAReadAligner(bwt_reference, bnt_annotation, ref_sequences, opts) {}
+  using BWAReadAligner::SketchFlank;
+  using BWAReadAligner::TrySeedFlank;
+};
+
+void BWAReadAlignerTest::setUp() {
+  // This environment variable is defined in './src/Makefile.am',
+  // Will be set during autotools' "make check" process.
+  char* test_dir_env = getenv("LOBSTR_TEST_DIR");
+  string test_dir = (test_dir_env != NULL) ? test_dir_env : "../tests";
+  string index_prefix = test_dir +
+    "/smallref/small_lobstr_ref_v2/lobSTR_ref.fasta";
+  _index.Load(index_prefix + ".mzi");
+  _bwt.bwt[0] = _bwt.bwt[1] = NULL;
+  _bwt.flank_filter = NULL;
+  _bwt.minimizer_index = &_index;
+  _bnt.bns = bns_restore(index_prefix.c_str());
+  _locus_index = NULL;
+  _locus_bnt.bns = NULL;
+  _opts = gap_init_opt();
+
+  ifstream fasta(index_prefix.c_str());
+  string line;
+  REFSEQ* refseq = NULL;
+  while (getline(fasta, line)) {
+    if (line.empty()) continue;
+    if (line[0] == '>') {
+      vector<string> items;
+      split(line.substr(1), '$', items);
+      refseq = &_ref_sequences[atoi(items.at(0).c_str())];
+      refseq->chrom = items.at(1);
+      refseq->start = atoi(items.at(2).c_str());
+      if (atoi(items.at(0).c_str()) == FLANK_LOCUS) {
+        _locus_name = line.substr(1);
+      }
+    } else if (refseq != NULL) {
+      refseq->sequence += line;
+    }
+  }
+  _flank = _ref_sequences[FLANK_LOCUS].sequence.substr(FLANK_OFFSET,
+                                                       FLANK_LENGTH);
+}
+
+void BWAReadAlignerTest::tearDown() {
+  bns_destroy(_bnt.bns);
+  if (_locus_bnt.bns != NULL) bns_destroy(_locus_bnt.bns);
+  delete _locus_index;
+  free(_opts);
+}
+
+vector<ALIGNMENT> BWAReadAlignerTest::SeedFlank(
+    const string& flank, BWT* bwt, BNT* bnt,
+    map<int, REFSEQ>* ref_sequences) {
+  SeedingAligner aligner(bwt, bnt, ref_sequences, _opts);
+  vector<ALIGNMENT> alignments;
+  CPPUNIT_ASSERT(aligner.TrySeedFlank(flank.data(), flank.size(),
+                                      &alignments));
+  return alignments;
+}
+
+string BWAReadAlignerTest::CopyFlank(const string& flank, int offset,
+                                     int mismatches) {
+  string sequence = _ref_sequences[FLANK_LOCUS].sequence;
+  string copy = flank;
+  for (int i = 0; i < mismatches; i++) {
+    char& base = copy[10 + 20*i];
+    base = (base == 'A') ? 'C' : 'A';
+  }
+  sequence.replace(offset, copy.size(), copy);
+  return sequence;
+}
+
+string BWAReadAlignerTest::InsertBase(const string& flank, int pos) {
+  const string bases = "ACGT";
+  size_t i = 0;
+  while (bases[i] == flank[pos-1] || bases[i] == flank[pos]) i++;
+  return flank.substr(0, pos) + bases[i] + flank.substr(pos);
+}
+
+void BWAReadAlignerTest::IndexLocus(const string& sequence,
+                                    map<int, REFSEQ>* ref_sequences) {
+  const char* tmp_dir = getenv("TMPDIR");
+  string dir = string(tmp_dir != NULL ? tmp_dir : "/tmp") +
+    "/lobSTR_test_XXXXXX";
+  vector<char> dir_template(dir.begin(), dir.end());
+  dir_template.push_back('\0');
+  CPPUNIT_ASSERT(mkdtemp(&dir_template[0]) != NULL);
+  dir = &dir_template[0];
+  const string prefix = dir + "/locus.fasta";
+  ofstream fasta(prefix.c_str());
+  fasta << ">" << _locus_name << "\n" << sequence << "\n";
+  fasta.close();
+  gzFile fp = gzopen(prefix.c_str(), "r");
+  bns_fasta2bntseq(fp, prefix.c_str());
+  gzclose(fp);
+  mz_index_build(prefix.c_str(), _index.k(), _index.w());
+
+  if (_locus_bnt.bns != NULL) bns_destroy(_locus_bnt.bns);
+  delete _locus_index;
+  _locus_index = new MinimizerIndex();
+  CPPUNIT_ASSERT(_locus_index->Load(prefix + ".mzi"));
+  _locus_bnt.bns = bns_restore(prefix.c_str());
+  _locus_bwt = _bwt;
+  _locus_bwt.minimizer_index = _locus_index;
+  const char* extensions[] = {"", ".pac", ".ann", ".amb", ".mzi"};
+  for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+    unlink((prefix + extensions[i]).c_str());
+  }
+  rmdir(dir.c_str());
+  (*ref_sequences)[FLANK_LOCUS].sequence = sequence;
+}
+
+void BWAReadAlignerTest::test_SketchFlank() {
+  SeedingAligner aligner(&_bwt, &_bnt, &_ref_sequences, _opts);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(FLANK_LENGTH), _flank.size());
+  CPPUNIT_ASSERT_EQUAL(string::npos, _flank.find('N'));
+  // Long enough for the one mismatch allowed
+  CPPUNIT_ASSERT(aligner.SketchFlank(_flank.data(), _flank.size()) > 1);
+  // Shorter than a window of k-mers
+  const int window = _index.k() + _index.w() - 1;
+  CPPUNIT_ASSERT_EQUAL(0, aligner.SketchFlank(_flank.data(), window - 1));
+  // A single window is lost with a difference anywhere in it
+  CPPUNIT_ASSERT_EQUAL(1, aligner.SketchFlank(_flank.data(), window));
+  vector<ALIGNMENT> alignments;
+  CPPUNIT_ASSERT(aligner.TrySeedFlank(_flank.data(), window, &alignments));
+  const int max_length = min_length_to_allow_mismatches;
+  min_length_to_allow_mismatches = window;
+  CPPUNIT_ASSERT(!aligner.TrySeedFlank(_flank.data(), window, &alignments));
+  min_length_to_allow_mismatches = max_length;
+}
+
+void BWAReadAlignerTest::test_SeedFlank() {
+  vector<ALIGNMENT> alignments = SeedFlank(_flank, &_bwt, &_bnt,
+                                           &_ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+  CPPUNIT_ASSERT_EQUAL(FLANK_LOCUS, alignments[0].id);
+  CPPUNIT_ASSERT(alignments[0].strand);
+  const int pos = alignments[0].pos;
+  CPPUNIT_ASSERT_EQUAL(pos + FLANK_LENGTH, alignments[0].endpos);
+  // Same place for the reverse complement, on the other strand
+  alignments = SeedFlank(reverseComplement(_flank), &_bwt, &_bnt,
+                         &_ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+  CPPUNIT_ASSERT(!alignments[0].strand);
+  CPPUNIT_ASSERT_EQUAL(pos - 1, alignments[0].pos);
+  // and with a mismatch anywhere
+  for (int i = 0; i < FLANK_LENGTH; i++) {
+    string flank = _flank;
+    flank[i] = (flank[i] == 'A') ? 'C' : 'A';
+    alignments = SeedFlank(flank, &_bwt, &_bnt, &_ref_sequences);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+    CPPUNIT_ASSERT_EQUAL(pos, alignments[0].pos);
+  }
+}
+
+void BWAReadAlignerTest::test_SeedFlankDuplicateInLocus() {
+  const int pos = SeedFlank(_flank, &_bwt, &_bnt, &_ref_sequences)[0].pos;
+  map<int, REFSEQ> ref_sequences = _ref_sequences;
+  IndexLocus(CopyFlank(_flank, COPY_OFFSET, 1), &ref_sequences);
+  vector<ALIGNMENT> alignments = SeedFlank(_flank, &_locus_bwt, &_locus_bnt,
+                                           &ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), alignments.size());
+  CPPUNIT_ASSERT_EQUAL(FLANK_LOCUS, alignments[0].id);
+  CPPUNIT_ASSERT_EQUAL(FLANK_LOCUS, alignments[1].id);
+  CPPUNIT_ASSERT_EQUAL(pos, min(alignments[0].pos, alignments[1].pos));
+  CPPUNIT_ASSERT_EQUAL(pos + COPY_OFFSET - FLANK_OFFSET,
+                       max(alignments[0].pos, alignments[1].pos));
+  // A copy on the other strand
+  IndexLocus(CopyFlank(reverseComplement(_flank), COPY_OFFSET, 1),
+             &ref_sequences);
+  alignments = SeedFlank(_flank, &_locus_bwt, &_locus_bnt, &ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), alignments.size());
+  CPPUNIT_ASSERT(alignments[0].strand != alignments[1].strand);
+  // Like BWA, a copy two mismatches worse than the best hit is not
+  // reported even if that many are allowed
+  const int mismatches = max_mismatch;
+  max_mismatch = 2;
+  IndexLocus(CopyFlank(_flank, COPY_OFFSET, 2), &ref_sequences);
+  alignments = SeedFlank(_flank, &_locus_bwt, &_locus_bnt, &ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+  CPPUNIT_ASSERT_EQUAL(pos, alignments[0].pos);
+  // but one a mismatch worse is
+  IndexLocus(CopyFlank(_flank, COPY_OFFSET, 1), &ref_sequences);
+  string flank = _flank;
+  flank[FLANK_LENGTH / 2] = (flank[FLANK_LENGTH / 2] == 'A') ? 'C' : 'A';
+  alignments = SeedFlank(flank, &_locus_bwt, &_locus_bnt, &ref_sequences);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), alignments.size());
+  max_mismatch = mismatches;
+}
+
+void BWAReadAlignerTest::test_SeedFlankGapNearEnd() {
+  // BWA allows a gap at a base of the flank at least indel_end_skip
+  // from its start and indel_end_skip-1 from its end, whichever
+  // strand the flank aligns to
+  const int end_skip = _opts->indel_end_skip;
+  const int length = FLANK_LENGTH + 1;
+  for (int strand = 0; strand < 2; strand++) {
+    const string flank = strand ? _flank : reverseComplement(_flank);
+    vector<ALIGNMENT> alignments =
+      SeedFlank(InsertBase(flank, end_skip), &_bwt, &_bnt, &_ref_sequences);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+    CPPUNIT_ASSERT_EQUAL(strand == 1, alignments[0].strand);
+    alignments = SeedFlank(InsertBase(flank, length - end_skip), &_bwt,
+                           &_bnt, &_ref_sequences);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), alignments.size());
+    CPPUNIT_ASSERT(SeedFlank(InsertBase(flank, end_skip - 1), &_bwt, &_bnt,
+                             &_ref_sequences).empty());
+    CPPUNIT_ASSERT(SeedFlank(InsertBase(flank, length - end_skip + 1), &_bwt,
+                             &_bnt, &_ref_sequences).empty());
+  }
+}
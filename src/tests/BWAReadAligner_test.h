@@ -0,0 +1,78 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_TESTS_BWAREADALIGNER_H__
+#define SRC_TESTS_BWAREADALIGNER_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/BWAReadAligner.h"
+#include "src/MinimizerIndex.h"
+
+class BWAReadAlignerTest :
+public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(BWAReadAlignerTest);
+  CPPUNIT_TEST(test_SketchFlank);
+  CPPUNIT_TEST(test_SeedFlank);
+  CPPUNIT_TEST(test_SeedFlankDuplicateInLocus);
+  CPPUNIT_TEST(test_SeedFlankGapNearEnd);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+  void setUp();
+  void tearDown();
+  void test_SketchFlank();
+  void test_SeedFlank();
+  void test_SeedFlankDuplicateInLocus();
+  void test_SeedFlankGapNearEnd();
+ private:
+  // Alignments the minimizer seeder gives the flank against the
+  // reference of bwt, bnt and ref_sequences
+  std::vector<ALIGNMENT> SeedFlank(const std::string& flank, BWT* bwt,
+                                   BNT* bnt,
+                                   std::map<int, REFSEQ>* ref_sequences);
+  // Locus sequence with a copy of the flank, one base changed for
+  // each of mismatches, at offset
+  std::string CopyFlank(const std::string& flank, int offset,
+                        int mismatches);
+  // The flank with a base inserted before base pos, one no neighbour
+  // has so the gap can only go there
+  std::string InsertBase(const std::string& flank, int pos);
+  // Index FLANK_LOCUS with sequence in place of its own into
+  // _locus_bwt and _locus_bnt, and put it in *ref_sequences
+  void IndexLocus(const std::string& sequence,
+                  std::map<int, REFSEQ>* ref_sequences);
+  MinimizerIndex _index;
+  BWT _bwt;
+  BNT _bnt;
+  MinimizerIndex* _locus_index;
+  BWT _locus_bwt;
+  BNT _locus_bnt;
+  gap_opt_t* _opts;
+  std::map<int, REFSEQ> _ref_sequences;
+  std::string _locus_name;
+  std::string _flank;
+};
+
+#endif //  SRC_TESTS_BWAREADALIGNER_H__
@@ -0,0 +1,165 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/tests/BamCollatingFileReader_test.h"
+#include "src/api/BamAlignment.h"
+#include "src/api/BamConstants.h"
+#include "src/BamCollatingFileReader.h"
+#include "src/ReadPair.h"
+#include "src/runtime_parameters.h"
+
+using namespace std;
+using BamTools::BamAlignment;
+using BamTools::BamWriter;
+namespace Constants = BamTools::Constants;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BamCollatingFileReaderTest);
+
+static const int NUM_PAIRS = 10;
+static const int READ_LENGTH = 50;
+static const uint16_t SUPPLEMENTARY = 0x800;
+
+static string PairName(int pair) {
+  stringstream name;
+  name << "pair" << pair;
+  return name.str();
+}
+
+void BamCollatingFileReaderTest::setUp() {
+  _max_pending = collate_max_pending;
+  const char* tmp_dir = getenv("TMPDIR");
+  string dir = string(tmp_dir != NULL ? tmp_dir : "/tmp") +
+    "/lobSTR_test_XXXXXX";
+  vector<char> dir_template(dir.begin(), dir.end());
+  dir_template.push_back('\0');
+  CPPUNIT_ASSERT(mkdtemp(&dir_template[0]) != NULL);
+  _dir = &dir_template[0];
+  _bam_file = _dir + "/collate.bam";
+  WriteBam();
+}
+
+void BamCollatingFileReaderTest::tearDown() {
+  collate_max_pending = _max_pending;
+  unlink(_bam_file.c_str());
+  rmdir(_dir.c_str());
+}
+
+void BamCollatingFileReaderTest::WriteRecord(BamWriter* writer,
+                                             const string& name,
+                                             uint16_t flag, char base) {
+  BamAlignment aln;
+  aln.Name = name;
+  aln.AlignmentFlag = flag | Constants::BAM_ALIGNMENT_UNMAPPED;
+  aln.QueryBases = string(READ_LENGTH, base);
+  aln.Qualities = string(READ_LENGTH, 'I');
+  aln.RefID = -1;
+  aln.Position = -1;
+  aln.MateRefID = -1;
+  aln.MatePosition = -1;
+  CPPUNIT_ASSERT(writer->SaveAlignment(aln));
+}
+
+void BamCollatingFileReaderTest::WriteBam() {
+  // The first mate of every pair comes before any second mate, so all
+  // pairs wait for their mate at once. Read 1 is all A, read 2 all C
+  const uint16_t read1 = Constants::BAM_ALIGNMENT_PAIRED |
+    Constants::BAM_ALIGNMENT_READ_1;
+  const uint16_t read2 = Constants::BAM_ALIGNMENT_PAIRED |
+    Constants::BAM_ALIGNMENT_READ_2;
+  BamWriter writer;
+  CPPUNIT_ASSERT(writer.Open(_bam_file, "@HD\tVN:1.4\tSO:unsorted\n",
+                             BamTools::RefVector()));
+  for (int i = 0; i < NUM_PAIRS; i++) {
+    // Odd pairs have read 2 first in the file
+    if (i % 2 == 0) {
+      WriteRecord(&writer, PairName(i), read1, 'A');
+    } else {
+      WriteRecord(&writer, PairName(i), read2, 'C');
+    }
+  }
+  WriteRecord(&writer, "single", 0, 'G');
+  WriteRecord(&writer, "orphan", read1, 'T');
+  // Other alignments of a mate must not be taken for the missing mate
+  WriteRecord(&writer, "orphan", read2 | Constants::BAM_ALIGNMENT_SECONDARY,
+              'T');
+  WriteRecord(&writer, PairName(3), read2 | SUPPLEMENTARY, 'T');
+  WriteRecord(&writer, PairName(4), read2 | Constants::BAM_ALIGNMENT_SECONDARY,
+              'T');
+  for (int i = NUM_PAIRS - 1; i >= 0; i--) {
+    if (i % 2 == 0) {
+      WriteRecord(&writer, PairName(i), read2, 'C');
+    } else {
+      WriteRecord(&writer, PairName(i), read1, 'A');
+    }
+  }
+  writer.Close();
+}
+
+void BamCollatingFileReaderTest::CheckPairs() {
+  BamCollatingFileReader reader(_bam_file);
+  ReadPair read_pair;
+  map<string, int> times_read;
+  while (reader.GetNextRecord(&read_pair)) {
+    const MSReadRecord& read = read_pair.reads[0];
+    times_read[read.ID]++;
+    if (read.ID == "single" || read.ID == "orphan") {
+      // Returned as single reads
+      CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), read_pair.reads.size());
+      CPPUNIT_ASSERT(!read.paired);
+      CPPUNIT_ASSERT_EQUAL(string(READ_LENGTH, read.ID == "single" ? 'G' : 'T'),
+                           read.nucleotides);
+      continue;
+    }
+    // Read 1 first, read 2 reverse complemented
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), read_pair.reads.size());
+    CPPUNIT_ASSERT(read.paired);
+    CPPUNIT_ASSERT(read_pair.reads[1].paired);
+    CPPUNIT_ASSERT_EQUAL(read.ID, read_pair.reads[1].ID);
+    CPPUNIT_ASSERT_EQUAL(string(READ_LENGTH, 'A'), read.nucleotides);
+    CPPUNIT_ASSERT_EQUAL(string(READ_LENGTH, 'G'),
+                         read_pair.reads[1].nucleotides);
+  }
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(NUM_PAIRS + 2), times_read.size());
+  for (int i = 0; i < NUM_PAIRS; i++) {
+    CPPUNIT_ASSERT_EQUAL(1, times_read[PairName(i)]);
+  }
+  CPPUNIT_ASSERT_EQUAL(1, times_read["single"]);
+  CPPUNIT_ASSERT_EQUAL(1, times_read["orphan"]);
+}
+
+void BamCollatingFileReaderTest::test_PairsInMemory() {
+  CheckPairs();
+}
+
+void BamCollatingFileReaderTest::test_PairsSpilled() {
+  // Spill after every few mates, so most pairs are only matched
+  // when the temporary files are read back
+  collate_max_pending = 2;
+  CheckPairs();
+}
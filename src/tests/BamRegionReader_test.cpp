@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <err.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/tests/BamRegionReader_test.h"
+#include "src/BamRegionReader.h"
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BamRegionReaderTest);
+
+/*
+  tests/str_regions/reads.bam holds 100bp reads on chr1, chr2 and chr3
+  (a 150bp one at chr1:1300) and two unmapped reads without a position
+  at the end. lobSTR_mergedref.bed next to it has STRs at chr1:0-10,
+  1000-1020, 1200-1230 and 1500-1510 (with the chromosome named "1"),
+  chr2:19950-19960 and on chr9, which is not in the bam file.
+ */
+static const char* ALL_READS[] = {
+  "clamped", "before_padding", "padding_left_out", "padding_left_in",
+  "merged", "unmapped_placed", "secondary", "supplementary", "reverse",
+  "merged_gap", "spanning", "adjacent", "padding_right_in",
+  "padding_right_out", "far", "chr2_out", "chr2_end", "chr3",
+  "unplaced1", "unplaced2"
+};
+
+void BamRegionReaderTest::setUp() {
+  // This environment variable is defined in './src/Makefile.am',
+  // Will be set during autotools' "make check" process.
+  char* test_dir_env = getenv("LOBSTR_TEST_DIR");
+  string test_dir = (test_dir_env != NULL) ? test_dir_env : "../tests";
+  _bam_file = test_dir + "/str_regions/reads.bam";
+  _index_prefix = index_prefix;
+  _padding = str_region_padding;
+  index_prefix = test_dir + "/str_regions/lobSTR_";
+}
+
+void BamRegionReaderTest::tearDown() {
+  index_prefix = _index_prefix;
+  str_region_padding = _padding;
+}
+
+void BamRegionReaderTest::CheckReads(const vector<string>& expected) {
+  BamRegionReader reader(_bam_file);
+  BamRecord record;
+  map<string, int> times_read;
+  while (reader.GetNextRecord(&record)) {
+    times_read[record.name]++;
+  }
+  CPPUNIT_ASSERT_EQUAL(expected.size(), times_read.size());
+  for (size_t i = 0; i < sizeof(ALL_READS) / sizeof(ALL_READS[0]); i++) {
+    const bool wanted = (find(expected.begin(), expected.end(),
+                              ALL_READS[i]) != expected.end());
+    CPPUNIT_ASSERT_EQUAL_MESSAGE(ALL_READS[i], wanted ? 1 : 0,
+                                 times_read[ALL_READS[i]]);
+  }
+}
+
+void BamRegionReaderTest::test_PaddedWindows() {
+  // Windows chr1:0-110, 900-1330 (two STRs merged), 1400-1610 and
+  // chr2:19850-20000, cut at the end of the chromosome. The read at
+  // chr1:1300 overlaps two windows, secondary and supplementary
+  // alignments are skipped, unplaced reads are read last
+  str_region_padding = 100;
+  const char* expected[] = {
+    "clamped", "padding_left_in", "merged", "unmapped_placed", "reverse",
+    "merged_gap", "spanning", "adjacent", "padding_right_in", "chr2_end",
+    "unplaced1", "unplaced2"
+  };
+  CheckReads(vector<string>(expected,
+                            expected + sizeof(expected) / sizeof(expected[0])));
+}
+
+void BamRegionReaderTest::test_NoPadding() {
+  // Only reads overlapping an STR
+  str_region_padding = 0;
+  const char* expected[] = {
+    "clamped", "merged", "unmapped_placed", "reverse", "merged_gap",
+    "chr2_end", "unplaced1", "unplaced2"
+  };
+  CheckReads(vector<string>(expected,
+                            expected + sizeof(expected) / sizeof(expected[0])));
+}
+
+void BamRegionReaderTest::test_ReverseStrand() {
+  // Reads on the reverse strand come back as sequenced
+  str_region_padding = 100;
+  BamRegionReader reader(_bam_file);
+  BamRecord record;
+  bool found = false;
+  while (reader.GetNextRecord(&record)) {
+    if (record.name != "reverse") continue;
+    string bases;
+    while (bases.size() < 100) bases += "GTTT";
+    CPPUNIT_ASSERT_EQUAL(bases, record.bases);
+    CPPUNIT_ASSERT_EQUAL(string(100, 'I'), record.qualities);
+    found = true;
+  }
+  CPPUNIT_ASSERT(found);
+}
@@ -0,0 +1,51 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_TESTS_BAMREGIONREADER_H__
+#define SRC_TESTS_BAMREGIONREADER_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class BamRegionReaderTest :
+public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(BamRegionReaderTest);
+  CPPUNIT_TEST(test_PaddedWindows);
+  CPPUNIT_TEST(test_NoPadding);
+  CPPUNIT_TEST(test_ReverseStrand);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+  void setUp();
+  void tearDown();
+  void test_PaddedWindows();
+  void test_NoPadding();
+  void test_ReverseStrand();
+ private:
+  void CheckReads(const std::vector<std::string>& expected);
+  std::string _bam_file;
+  std::string _index_prefix;
+  int _padding;
+};
+
+#endif //  SRC_TESTS_BAMREGIONREADER_H__
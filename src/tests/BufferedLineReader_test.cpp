@@ -0,0 +1,90 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/tests/BufferedLineReader_test.h"
+#include "src/BufferedLineReader.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BufferedLineReaderTest);
+
+void BufferedLineReaderTest::setUp() {}
+void BufferedLineReaderTest::tearDown() {}
+
+static string ViewString(const LineView& view) {
+  return string(view.data, view.length);
+}
+
+void BufferedLineReaderTest::test_MemoryLines() {
+  // Empty lines are kept, the last line needs no newline
+  string text = "@read1\nACGT\n\nIIII\nlast";
+  BufferedLineReader reader(text.data(), text.size());
+  LineView lines[4];
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), reader.GetLines(4, lines));
+  CPPUNIT_ASSERT_EQUAL(string("@read1"), ViewString(lines[0]));
+  CPPUNIT_ASSERT_EQUAL(string("ACGT"), ViewString(lines[1]));
+  CPPUNIT_ASSERT_EQUAL(string(""), ViewString(lines[2]));
+  CPPUNIT_ASSERT_EQUAL(string("IIII"), ViewString(lines[3]));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), reader.GetLines(1, lines));
+  CPPUNIT_ASSERT_EQUAL(string("last"), ViewString(lines[0]));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reader.GetLines(1, lines));
+}
+
+void BufferedLineReaderTest::test_PartialRecord() {
+  // A trailing newline does not start another line
+  string text = ">read1\nACGT\n>read2\n";
+  BufferedLineReader reader(text.data(), text.size());
+  LineView lines[2];
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), reader.GetLines(2, lines));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), reader.GetLines(2, lines));
+  CPPUNIT_ASSERT_EQUAL(string(">read2"), ViewString(lines[0]));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reader.GetLines(2, lines));
+}
+
+void BufferedLineReaderTest::test_StreamLines() {
+  // Records span several buffer refills, one line is longer than the
+  // initial buffer
+  vector<string> expected;
+  stringstream text;
+  for (int i = 0; i < 200000; i++) {
+    stringstream line;
+    line << "line" << i;
+    if (i == 1000) {
+      line << string(3*1024*1024, 'A');
+    }
+    expected.push_back(line.str());
+    text << line.str() << "\n";
+  }
+  BufferedLineReader reader(&text);
+  LineView lines[3];
+  size_t line_num = 0;
+  size_t num_lines;
+  while ((num_lines = reader.GetLines(3, lines)) > 0) {
+    for (size_t i = 0; i < num_lines; i++) {
+      CPPUNIT_ASSERT_EQUAL(expected.at(line_num), ViewString(lines[i]));
+      line_num++;
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL(expected.size(), line_num);
+}
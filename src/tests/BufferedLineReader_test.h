@@ -0,0 +1,44 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_TESTS_BUFFEREDLINEREADER_H__
+#define SRC_TESTS_BUFFEREDLINEREADER_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "src/BufferedLineReader.h"
+
+class BufferedLineReaderTest :
+public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(BufferedLineReaderTest);
+  CPPUNIT_TEST(test_MemoryLines);
+  CPPUNIT_TEST(test_PartialRecord);
+  CPPUNIT_TEST(test_StreamLines);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+  void setUp();
+  void tearDown();
+  void test_MemoryLines();
+  void test_PartialRecord();
+  void test_StreamLines();
+};
+
+#endif //  SRC_TESTS_BUFFEREDLINEREADER_H__
@@ -0,0 +1,98 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+  Microbenchmark of the entropy filter on random 100-250bp reads:
+  every window computed on its own with EntropyOneWindowDinuc, as
+  before the sliding histogram, against EntropyDetection.
+  Not built by default: make entropyBenchmark
+  Usage: entropyBenchmark [num_reads] [window_size] [window_step]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "src/tests/DNATools.h"
+#include "src/EntropyDetection.h"
+
+using namespace std;
+
+// Reads are drawn from a pool, so generating them is not timed
+static const int NUM_POOL_READS = 10000;
+
+static double Seconds(clock_t start) {
+  return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[]) {
+  const int num_reads = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const size_t size = (argc > 2) ? atoi(argv[2]) : 16;
+  const size_t step = (argc > 3) ? atoi(argv[3]) : 4;
+  if (num_reads <= 0 || size < 2 || step < 1) {
+    fprintf(stderr, "Usage: %s [num_reads] [window_size] [window_step]\n",
+            argv[0]);
+    return 1;
+  }
+  srand(1);
+  vector<string> pool(NUM_POOL_READS);
+  for (int i = 0; i < NUM_POOL_READS; i++) {
+    pool[i] = DNATools::RandDNA(100 + rand() % 151);
+  }
+
+  // Sums of the max entropies, so the work is not optimized away
+  double window_sum = 0;
+  clock_t start = clock();
+  for (int i = 0; i < num_reads; i++) {
+    const string& nucs = pool[i % NUM_POOL_READS];
+    EntropyDetection ed(nucs, size, step);
+    double max_entropy = 0;
+    for (size_t j = 0; j + size < nucs.length(); j += step) {
+      double entropy = ed.EntropyOneWindowDinuc(nucs.substr(j, size));
+      if (entropy > 0.8) entropy = 0;
+      max_entropy = max(max_entropy, entropy);
+    }
+    window_sum += max_entropy;
+  }
+  const double window_seconds = Seconds(start);
+
+  double sliding_sum = 0;
+  int num_above = 0;
+  start = clock();
+  for (int i = 0; i < num_reads; i++) {
+    EntropyDetection ed(pool[i % NUM_POOL_READS], size, step);
+    if (ed.EntropyIsAboveThreshold()) num_above++;
+    sliding_sum += ed.GetMaxEntropy();
+  }
+  const double sliding_seconds = Seconds(start);
+
+  printf("%d reads of 100-250bp, window %d, step %d\n", num_reads,
+         static_cast<int>(size), static_cast<int>(step));
+  printf("one window at a time: %8.2f s (mean max entropy %.4f)\n",
+         window_seconds, window_sum / num_reads);
+  printf("EntropyDetection:     %8.2f s (mean max entropy %.4f, %d above "
+         "threshold)\n", sliding_seconds, sliding_sum / num_reads, num_above);
+  printf("speedup:              %8.1fx\n", window_seconds / sliding_seconds);
+  return 0;
+}
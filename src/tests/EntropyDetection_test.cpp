@@ -0,0 +1,88 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+
+#include "src/tests/EntropyDetection_test.h"
+#include "src/tests/DNATools.h"
+#include "src/EntropyDetection.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EntropyDetectionTest);
+
+void EntropyDetectionTest::setUp() {}
+void EntropyDetectionTest::tearDown() {}
+
+// Max entropy computed one window at a time
+static double MaxEntropyOneWindowAtATime(const string& nucs,
+                                         size_t size, size_t step) {
+  EntropyDetection ed(nucs, size, step);
+  double max_entropy = 0;
+  for (size_t i = 0; i < nucs.length() - size; i += step) {
+    double entropy = ed.EntropyOneWindowDinuc(nucs.substr(i, size));
+    if (entropy > 0.8)
+      entropy = 0;
+    max_entropy = max(max_entropy, entropy);
+  }
+  return max_entropy;
+}
+
+void EntropyDetectionTest::test_MaxEntropy() {
+  string repeat;
+  while (repeat.size() < 40) repeat += "CA";
+  EntropyDetection ed_repeat("GTTCAGATCGGATAC" + repeat + "GTTCAGATCGGATAC",
+                             16, 4);
+  EntropyDetection ed_random(DNATools::RandDNA(80), 16, 4);
+  CPPUNIT_ASSERT(ed_repeat.EntropyIsAboveThreshold());
+  CPPUNIT_ASSERT(ed_repeat.GetMaxEntropy() > ed_random.GetMaxEntropy());
+  // A homopolymer has no entropy to speak of, and is set to 0
+  EntropyDetection ed_homopolymer(string(60, 'A'), 16, 4);
+  CPPUNIT_ASSERT_EQUAL(0.0f, ed_homopolymer.GetMaxEntropy());
+}
+
+void EntropyDetectionTest::test_SlidingWindow() {
+  srand(2);
+  const size_t sizes[] = {16, 24, 8};
+  const size_t steps[] = {4, 1, 10};
+  for (int i = 0; i < 500; i++) {
+    string nucs = DNATools::RandDNA(40 + rand() % 110);
+    // Low complexity stretches, Ns and other IUPAC codes
+    string unit = DNATools::RandDNA(1 + rand() % 4);
+    string repeat;
+    while (repeat.size() < 30) repeat += unit;
+    nucs.replace(rand() % (nucs.size() - repeat.size()),
+                 repeat.size(), repeat);
+    for (int j = rand() % 4; j > 0; j--) {
+      nucs[rand() % nucs.size()] = 'N';
+    }
+    if (i % 10 == 0) {
+      nucs[rand() % nucs.size()] = 'R';
+    }
+    for (size_t k = 0; k < 3; k++) {
+      EntropyDetection ed(nucs, sizes[k], steps[k]);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(MaxEntropyOneWindowAtATime(nucs, sizes[k], steps[k]),
+                                   ed.GetMaxEntropy(), 1e-6);
+    }
+  }
+}
@@ -0,0 +1,102 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+
+#include "src/tests/FlankFilter_test.h"
+#include "src/common.h"
+#include "src/FlankFilter.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FlankFilterTest);
+
+void FlankFilterTest::setUp() {
+  // This environment variable is defined in './src/Makefile.am',
+  // Will be set during autotools' "make check" process.
+  char* test_dir_env = getenv("LOBSTR_TEST_DIR");
+  string test_dir = (test_dir_env != NULL) ? test_dir_env : "../tests";
+  _index_prefix = test_dir + "/smallref/small_lobstr_ref_v2/lobSTR_ref.fasta";
+  _filter = new FlankFilter();
+  _filter->Load(_index_prefix + ".kmf");
+}
+
+void FlankFilterTest::tearDown() {
+  delete _filter;
+}
+
+void FlankFilterTest::test_Load() {
+  CPPUNIT_ASSERT(_filter->loaded());
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(20), _filter->k());
+  FlankFilter missing;
+  CPPUNIT_ASSERT(!missing.Load(_index_prefix + ".missing"));
+  CPPUNIT_ASSERT(!missing.loaded());
+}
+
+void FlankFilterTest::test_ReferenceKmers() {
+  ifstream fasta(_index_prefix.c_str());
+  string line;
+  size_t checked = 0;
+  while (getline(fasta, line)) {
+    if (line.empty() || line[0] == '>') continue;
+    for (size_t i = 0; i + 60 <= line.size(); i += 97) {
+      string flank = line.substr(i, 60);
+      if (flank.find('N') != string::npos) continue;
+      // Either strand, any case
+      CPPUNIT_ASSERT(_filter->HasKmerHit(flank.data(), flank.size()));
+      string rc = reverseComplement(flank);
+      CPPUNIT_ASSERT(_filter->HasKmerHit(rc.data(), rc.size()));
+      string kmer = flank.substr(17, 20);
+      CPPUNIT_ASSERT(_filter->HasKmerHit(kmer.data(), kmer.size()));
+      for (size_t j = 0; j < kmer.size(); j++) {
+        kmer[j] = tolower(kmer[j]);
+      }
+      CPPUNIT_ASSERT(_filter->HasKmerHit(kmer.data(), kmer.size()));
+      checked++;
+    }
+  }
+  CPPUNIT_ASSERT(checked > 100);
+}
+
+void FlankFilterTest::test_OtherKmers() {
+  // Random 20-mers are rarely in a 28kb reference
+  const char nucs[] = "ACGT";
+  srand(7);
+  int hits = 0;
+  for (int i = 0; i < 1000; i++) {
+    string kmer(20, 'A');
+    for (size_t j = 0; j < kmer.size(); j++) {
+      kmer[j] = nucs[rand() % 4];
+    }
+    if (_filter->HasKmerHit(kmer.data(), kmer.size())) hits++;
+  }
+  CPPUNIT_ASSERT(hits < 20);
+  // Too short, or broken up by Ns
+  string flank = "CGCCCAGCTAATTTTTTGTCTTTTTAGTAGAGACAGGG";
+  CPPUNIT_ASSERT(_filter->HasKmerHit(flank.data(), flank.size()));
+  CPPUNIT_ASSERT(!_filter->HasKmerHit(flank.data(), 19));
+  for (size_t i = 10; i < flank.size(); i += 10) {
+    flank[i] = 'N';
+  }
+  CPPUNIT_ASSERT(!_filter->HasKmerHit(flank.data(), flank.size()));
+}
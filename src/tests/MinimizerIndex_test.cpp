@@ -0,0 +1,167 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/tests/MinimizerIndex_test.h"
+#include "src/common.h"
+#include "src/MinimizerIndex.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MinimizerIndexTest);
+
+void MinimizerIndexTest::setUp() {
+  // This environment variable is defined in './src/Makefile.am',
+  // Will be set during autotools' "make check" process.
+  char* test_dir_env = getenv("LOBSTR_TEST_DIR");
+  string test_dir = (test_dir_env != NULL) ? test_dir_env : "../tests";
+  _index_prefix = test_dir + "/smallref/small_lobstr_ref_v2/lobSTR_ref.fasta";
+  _index = new MinimizerIndex();
+  _index->Load(_index_prefix + ".mzi");
+}
+
+void MinimizerIndexTest::tearDown() {
+  delete _index;
+}
+
+bool MinimizerIndexTest::HasPosition(uint32_t hash, uint64_t seqid,
+                                     int offset, uint32_t strand) {
+  const uint64_t* positions;
+  size_t num_positions = _index->Lookup(hash, &positions);
+  const uint64_t position = seqid << 32 |
+    static_cast<uint64_t>(offset) << 1 | strand;
+  for (size_t i = 0; i < num_positions; i++) {
+    if (positions[i] == position) return true;
+  }
+  return false;
+}
+
+void MinimizerIndexTest::test_Load() {
+  CPPUNIT_ASSERT(_index->loaded());
+  CPPUNIT_ASSERT_EQUAL(MZ_INDEX_DEFAULT_K, _index->k());
+  CPPUNIT_ASSERT_EQUAL(MZ_INDEX_DEFAULT_W, _index->w());
+  MinimizerIndex missing;
+  CPPUNIT_ASSERT(!missing.Load(_index_prefix + ".missing"));
+  CPPUNIT_ASSERT(!missing.loaded());
+}
+
+void MinimizerIndexTest::test_Sketch() {
+  const int k = _index->k();
+  const int w = _index->w();
+  vector<mz_t> minimizers;
+  string seq = "CGCCCAGCTAATTTTTTGTCTTTTTAGTAGAGACAGGGTTTCACCATGTTGGCCAGG";
+  _index->Sketch(seq.data(), seq.size(), &minimizers);
+  CPPUNIT_ASSERT(!minimizers.empty());
+  // Every window of w k-mers has its minimizer, and they are in order
+  int last = -1;
+  for (size_t i = 0; i < minimizers.size(); i++) {
+    int pos = static_cast<int>(minimizers[i].pos >> 1);
+    CPPUNIT_ASSERT(pos > last && pos + k <= static_cast<int>(seq.size()));
+    CPPUNIT_ASSERT(pos - last <= w);
+    last = pos;
+  }
+  CPPUNIT_ASSERT(static_cast<int>(seq.size()) - k - last < w);
+  // The reverse complement has the same minimizers on the other strand
+  string rc = reverseComplement(seq);
+  vector<mz_t> rc_minimizers;
+  _index->Sketch(rc.data(), rc.size(), &rc_minimizers);
+  CPPUNIT_ASSERT_EQUAL(minimizers.size(), rc_minimizers.size());
+  for (size_t i = 0; i < minimizers.size(); i++) {
+    const mz_t& m = minimizers[i];
+    const mz_t& r = rc_minimizers[minimizers.size() - 1 - i];
+    CPPUNIT_ASSERT_EQUAL(m.hash, r.hash);
+    CPPUNIT_ASSERT_EQUAL(static_cast<int>(seq.size()) - k -
+                         static_cast<int>(m.pos >> 1),
+                         static_cast<int>(r.pos >> 1));
+    CPPUNIT_ASSERT((m.pos & 1) != (r.pos & 1));
+  }
+  // Shorter than a window: the smallest k-mer. Shorter than a k-mer,
+  // or broken up by Ns: nothing
+  _index->Sketch(seq.data(), k + w - 2, &minimizers);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), minimizers.size());
+  _index->Sketch(seq.data(), k - 1, &minimizers);
+  CPPUNIT_ASSERT(minimizers.empty());
+  for (size_t i = k - 1; i < seq.size(); i += k - 1) {
+    seq[i] = 'N';
+  }
+  _index->Sketch(seq.data(), seq.size(), &minimizers);
+  CPPUNIT_ASSERT(minimizers.empty());
+}
+
+void MinimizerIndexTest::test_ReferenceMinimizers() {
+  const int k = _index->k();
+  // Reference sequences in the order they were indexed
+  ifstream fasta(_index_prefix.c_str());
+  vector<string> refs;
+  string line;
+  while (getline(fasta, line)) {
+    if (line.empty()) continue;
+    if (line[0] == '>') {
+      refs.push_back("");
+    } else {
+      refs.back() += line;
+    }
+  }
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), refs.size());
+  size_t checked = 0;
+  vector<mz_t> minimizers;
+  for (size_t seqid = 0; seqid < refs.size(); seqid++) {
+    for (size_t offset = 0; offset + 60 <= refs[seqid].size(); offset += 97) {
+      string flank = refs[seqid].substr(offset, 60);
+      if (flank.find('N') != string::npos) continue;
+      // Minimizers of either strand are found where they are
+      _index->Sketch(flank.data(), flank.size(), &minimizers);
+      CPPUNIT_ASSERT(!minimizers.empty());
+      for (size_t i = 0; i < minimizers.size(); i++) {
+        CPPUNIT_ASSERT(HasPosition(minimizers[i].hash, seqid,
+                                   offset + (minimizers[i].pos >> 1),
+                                   minimizers[i].pos & 1));
+      }
+      string rc = reverseComplement(flank);
+      _index->Sketch(rc.data(), rc.size(), &minimizers);
+      for (size_t i = 0; i < minimizers.size(); i++) {
+        CPPUNIT_ASSERT(HasPosition(minimizers[i].hash, seqid,
+                                   offset + 60 - k - (minimizers[i].pos >> 1),
+                                   1 - (minimizers[i].pos & 1)));
+      }
+      checked++;
+    }
+  }
+  CPPUNIT_ASSERT(checked > 100);
+  // A random 60-mer is not in a 20kb reference
+  const char nucs[] = "ACGT";
+  srand(11);
+  string other(60, 'A');
+  for (size_t j = 0; j < other.size(); j++) {
+    other[j] = nucs[rand() % 4];
+  }
+  _index->Sketch(other.data(), other.size(), &minimizers);
+  size_t hits = 0;
+  for (size_t i = 0; i < minimizers.size(); i++) {
+    const uint64_t* positions;
+    hits += _index->Lookup(minimizers[i].hash, &positions);
+  }
+  CPPUNIT_ASSERT(hits < 2);
+}
@@ -0,0 +1,52 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SRC_TESTS_MINIMIZERINDEX_H__
+#define SRC_TESTS_MINIMIZERINDEX_H__
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include "src/MinimizerIndex.h"
+
+class MinimizerIndexTest :
+public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(MinimizerIndexTest);
+  CPPUNIT_TEST(test_Load);
+  CPPUNIT_TEST(test_Sketch);
+  CPPUNIT_TEST(test_ReferenceMinimizers);
+  CPPUNIT_TEST_SUITE_END();
+
+ public:
+  void setUp();
+  void tearDown();
+  void test_Load();
+  void test_Sketch();
+  void test_ReferenceMinimizers();
+ private:
+  // True if the index has the minimizer at seqid, offset and strand
+  bool HasPosition(uint32_t hash, uint64_t seqid, int offset,
+                   uint32_t strand);
+  MinimizerIndex* _index;
+  std::string _index_prefix;
+};
+
+#endif //  SRC_TESTS_MINIMIZERINDEX_H__
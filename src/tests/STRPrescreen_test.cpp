@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2011-2014 Melissa Gymrek <mgymrek@mit.edu>
+
+This file is part of lobSTR.
+
+lobSTR is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+lobSTR is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+
+#include <string>
+
+#include "src/tests/STRPrescreen_test.h"
+#include "src/tests/DNATools.h"
+#include "src/common.h"
+#include "src/runtime_parameters.h"
+#include "src/STRPrescreen.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(STRPrescreenTest);
+
+void STRPrescreenTest::setUp() {}
+void STRPrescreenTest::tearDown() {}
+
+static bool Prescreen(const string& nucs) {
+  return PrescreenRead(nucs.data(), nucs.size());
+}
+
+void STRPrescreenTest::test_PrescreenRead() {
+  string flank(40, 'A');
+  for (size_t i = 0; i < flank.size(); i++) {
+    flank[i] = "ACGT"[(i * 7 + i / 3) % 4];
+  }
+  // A perfect repeat of every period passes
+  const char* units[] = {"A", "AC", "AGT", "ACTG", "AACCG", "AAGCTT"};
+  for (size_t k = 0; k < 6; k++) {
+    string repeat;
+    while (repeat.size() < 30) repeat += units[k];
+    CPPUNIT_ASSERT(Prescreen(flank + repeat + flank));
+  }
+  // Too short to be processed
+  CPPUNIT_ASSERT(!Prescreen("ACACACACAC"));
+  // Too many Ns
+  CPPUNIT_ASSERT(!Prescreen(string(100, 'N')));
+}
+
+void STRPrescreenTest::test_NoFalseNegatives() {
+  // Whenever the pre-screen rejects a read that passes the length and
+  // N checks, CheckRepeatCount must reject it for every period
+  srand(1);
+  size_t screened_out = 0;
+  for (int i = 0; i < 2000; i++) {
+    string nucs = DNATools::RandDNA(60 + rand() % 90);
+    if (i % 2 == 0) {
+      string unit = DNATools::RandDNA(1 + rand() % 6);
+      string repeat;
+      size_t length = rand() % 16;
+      while (repeat.size() < length) repeat += unit;
+      nucs.replace(rand() % (nucs.size() - repeat.size()),
+                   repeat.size(), repeat);
+    }
+    if (Prescreen(nucs)) continue;
+    screened_out++;
+    if (nucs.size() < fft_window_size - 1 ||
+        calculate_N_percentage(nucs) > percent_N_discard) continue;
+    string kmer;
+    for (size_t k = 1; k <= 6; k++) {
+      CPPUNIT_ASSERT(!CheckRepeatCount(nucs, k, MIN_REP_LENGTH[k-1], &kmer));
+    }
+  }
+  CPPUNIT_ASSERT(screened_out > 0);
+}
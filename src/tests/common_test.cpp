@@ -18,6 +18,8 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 */
 
+#include <stdlib.h>
+
 #include <cppunit/CompilerOutputter.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/ui/text/TestRunner.h>
@@ -26,6 +28,7 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "src/tests/common_test.h"
+#include "src/tests/DNATools.h"
 #include "src/runtime_parameters.h"
 
 // Registers the fixture into the 'registry'
@@ -61,6 +64,56 @@ void CommonTest::test_CheckRepeatCount() {
   CPPUNIT_ASSERT_MESSAGE("CheckRepeatCount failed", !check);
 }
 
+// CheckRepeatCount as it was written before kmers were packed
+static bool CheckRepeatCountMap(const std::string& nucs, size_t k,
+                                size_t minlen, std::string* bestkmer) {
+  std::map<std::string, int> countKMers;
+  std::string kmer = "";
+  int maxkmer = 0;
+  for (size_t i = 0; i < nucs.size() - k; i=i+k) {
+    std::string subseq = nucs.substr(i, k);
+    countKMers[subseq]++;
+    if (countKMers[subseq] > maxkmer) {
+      kmer = subseq;
+      maxkmer = countKMers[subseq];
+    }
+  }
+  *bestkmer = kmer;
+  std::string kmerrep;
+  while (kmerrep.size() < minlen) kmerrep += kmer;
+  return nucs.find(kmerrep.substr(0, minlen)) != std::string::npos;
+}
+
+void CommonTest::test_CheckRepeatCounts() {
+  srand(3);
+  for (int i = 0; i < 2000; i++) {
+    std::string nucs = DNATools::RandDNA(30 + rand() % 120);
+    std::string unit = DNATools::RandDNA(1 + rand() % 6);
+    std::string repeat;
+    size_t length = rand() % 20;
+    while (repeat.size() < length) repeat += unit;
+    nucs.replace(rand() % (nucs.size() - repeat.size()),
+                 repeat.size(), repeat);
+    // Ns and other IUPAC codes, or many of them to overflow the
+    // list of kmers with other characters
+    int num_other = (i % 50 == 0) ? 100 : rand() % 4;
+    for (int j = 0; j < num_other; j++) {
+      nucs[rand() % nucs.size()] = "NRn"[rand() % 3];
+    }
+    bool any_period = false;
+    for (size_t k = 1; k <= 6; k++) {
+      std::string kmer, expected_kmer;
+      bool expected = CheckRepeatCountMap(nucs, k, MIN_REP_LENGTH[k-1],
+                                          &expected_kmer);
+      CPPUNIT_ASSERT_EQUAL(expected,
+                           CheckRepeatCount(nucs, k, MIN_REP_LENGTH[k-1], &kmer));
+      CPPUNIT_ASSERT_EQUAL(expected_kmer, kmer);
+      any_period |= expected;
+    }
+    CPPUNIT_ASSERT_EQUAL(any_period, CheckRepeatCounts(nucs));
+  }
+}
+
 void CommonTest::test_reverseComplement() {
   // Case 1: upper case
   std::string nucs = "ACGATCGTGTCATGCNNACCACG";
@@ -29,6 +29,7 @@ class CommonTest :
 public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(CommonTest);
   CPPUNIT_TEST(test_TrimRead);
+  CPPUNIT_TEST(test_CheckRepeatCounts);
   CPPUNIT_TEST(test_reverseComplement);
   CPPUNIT_TEST(test_reverse);
   CPPUNIT_TEST(test_ExtractCigar);
@@ -40,6 +41,7 @@ public CppUnit::TestFixture {
  private:
   void test_TrimRead();
   void test_CheckRepeatCount();
+  void test_CheckRepeatCounts();
   void test_reverseComplement();
   void test_reverse();
   void test_ExtractCigar();
@@ -22,11 +22,20 @@ along with lobSTR.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "src/tests/AlignmentFilters_test.h"
 #include "src/tests/AlignmentUtils_test.h"
+#include "src/tests/AutocorrelationDetection_test.h"
+#include "src/tests/BamCollatingFileReader_test.h"
+#include "src/tests/BamRegionReader_test.h"
+#include "src/tests/BufferedLineReader_test.h"
+#include "src/tests/BWAReadAligner_test.h"
 #include "src/tests/common_test.h"
+#include "src/tests/EntropyDetection_test.h"
+#include "src/tests/FlankFilter_test.h"
 #include "src/tests/logistic_regression_test.h"
+#include "src/tests/MinimizerIndex_test.h"
 #include "src/tests/NWNoRefEndPenalty_test.h"
 #include "src/tests/ReadContainer_test.h"
 #include "src/tests/RemoveDuplicates_test.h"
+#include "src/tests/STRPrescreen_test.h"
 #include "src/tests/VCFWriter_test.h"
 #include "src/tests/ZAlgorithm_test.h"
 
@@ -35,11 +44,20 @@ int main() {
   CppUnit::TextUi::TestRunner runner;
   runner.addTest(AlignmentFiltersTest::suite());
   runner.addTest(AlignmentUtilsTest::suite());
+  runner.addTest(AutocorrelationDetectionTest::suite());
+  runner.addTest(BamCollatingFileReaderTest::suite());
+  runner.addTest(BamRegionReaderTest::suite());
+  runner.addTest(BufferedLineReaderTest::suite());
+  runner.addTest(BWAReadAlignerTest::suite());
   runner.addTest(CommonTest::suite());
+  runner.addTest(EntropyDetectionTest::suite());
+  runner.addTest(FlankFilterTest::suite());
   runner.addTest(LogisticRegressionTest::suite());
+  runner.addTest(MinimizerIndexTest::suite());
   runner.addTest(NWNoRefEndPenaltyTest::suite());
   runner.addTest(ReadContainerTest::suite());
   runner.addTest(RemoveDuplicatesTest::suite());
+  runner.addTest(STRPrescreenTest::suite());
   runner.addTest(VCFWriterTest::suite());
   runner.addTest(ZAlgorithmTest::suite());
 
@@ -237,6 +237,33 @@ lobSTR \
   --multi \
   --rg-lib test --rg-sample test >/dev/null 2>&1
 testcode 0
+lobSTR \
+  --index-prefix ${LOBSTR_TEST_DIR=.}/smallref/small_lobstr_ref_v2/lobSTR_ \
+  --out ${OUTDIR}/lobtest \
+  --verbose \
+  -f ${LOBSTR_TEST_DIR=.}/tmp_1.fq \
+  -q \
+  --anchor-verify \
+  --rg-lib test --rg-sample test >/dev/null 2>&1
+testcode 0
+lobSTR \
+  --index-prefix ${LOBSTR_TEST_DIR=.}/smallref/small_lobstr_ref_v2/lobSTR_ \
+  --out ${OUTDIR}/lobtest \
+  --verbose \
+  -f ${LOBSTR_TEST_DIR=.}/tmp_1.fq \
+  -q \
+  --seeder minimizer \
+  --rg-lib test --rg-sample test >/dev/null 2>&1
+testcode 0
+lobSTR \
+  --index-prefix ${LOBSTR_TEST_DIR=.}/smallref/small_lobstr_ref_v2/lobSTR_ \
+  --out ${OUTDIR}/lobtest \
+  --verbose \
+  -f ${LOBSTR_TEST_DIR=.}/tmp_1.fq \
+  -q \
+  --seeder blast \
+  --rg-lib test --rg-sample test >/dev/null 2>&1
+testcode 1
 lobSTR \
   --index-prefix ${LOBSTR_TEST_DIR=.}/smallref/small_lobstr_ref_v2/lobSTR_ \
   --out ${OUTDIR}/lobtest \